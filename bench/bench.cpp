@@ -0,0 +1,392 @@
+// Benchmark runner for all components. Build from the repository root:
+//
+//   g++ -std=c++17 -O2 -pthread bench/*.cpp -o bench_run
+//
+// Usage:
+//   bench_run [--filter <text>] [--repetitions <n>] [--warmup <n>]
+//             [--counters] [--out <file.json>] [--baseline <file.json>]
+//             [--threshold <percent>]
+//
+// Each case is warmed up, then timed for the given number of repetitions;
+// times are reported per operation. --counters adds cycles, instructions,
+// cache misses and branch misses from perf_event_open (Linux only, needs
+// perf_event_paranoid <= 2), including the work of threads a case starts and
+// joins; counts the kernel had to extrapolate from time-sliced counters are
+// marked with "counters_scaled". Results are written as JSON to --out or
+// stdout. With --baseline the medians are compared against a file written by
+// --out, and the exit code is 1 if any case got slower than --threshold.
+
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char *counterNames[] = {"cycles", "instructions", "cache_misses",
+                              "branch_misses"};
+constexpr std::size_t counterCount = 4;
+
+// Hardware counters of the calling thread. They are inherited by threads it
+// creates, whose counts are added when they exit, so threaded cases that join
+// their workers are counted in full. The counters are opened, enabled and
+// read one by one rather than as a group. When the kernel has more events
+// than hardware counters it time-slices them; each value is then scaled by
+// time enabled / time running and scaled() reports it.
+class PerfCounters {
+public:
+  PerfCounters() {
+#if defined(__linux__)
+    const std::uint64_t configs[counterCount] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (std::size_t i = 0; i < counterCount; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      int fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if (fd < 0) {
+        close();
+        return;
+      }
+      fds.push_back(fd);
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  void operator=(const PerfCounters &) = delete;
+
+  ~PerfCounters() { close(); }
+
+  bool available() const { return !fds.empty(); }
+
+  void start() {
+#if defined(__linux__)
+    for (auto fd : fds) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  std::vector<double> stop() {
+    std::vector<double> values(counterCount, 0);
+#if defined(__linux__)
+    for (auto fd : fds) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+      // value, time enabled, time running
+      std::uint64_t buffer[3] = {};
+      if (read(fds[i], buffer, sizeof(buffer)) != sizeof(buffer)) {
+        continue;
+      }
+      values[i] = static_cast<double>(buffer[0]);
+      if (buffer[2] < buffer[1]) {
+        values[i] = buffer[2] ? values[i] * buffer[1] / buffer[2] : 0;
+        wasScaled = true;
+      }
+    }
+#endif
+    return values;
+  }
+
+  // Whether any value returned by stop() so far was extrapolated.
+  bool scaled() const { return wasScaled; }
+  void clearScaled() { wasScaled = false; }
+
+private:
+  std::vector<int> fds;
+  bool wasScaled = false;
+
+  void close() {
+#if defined(__linux__)
+    for (auto fd : fds) {
+      ::close(fd);
+    }
+#endif
+    fds.clear();
+  }
+};
+
+struct Options {
+  std::string filter;
+  int repetitions = 15;
+  int warmup = 3;
+  bool counters = false;
+  std::string out;
+  std::string baseline;
+  double threshold = 5;
+};
+
+struct Result {
+  const Bench::Case *benchCase;
+  double minNs, medianNs, meanNs, stddevNs;
+  std::optional<std::vector<double>> counters;
+  bool countersScaled;
+};
+
+// Discards everything written to std::cout while cases run.
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+};
+
+Result run(const Bench::Case &benchCase, const Options &options,
+           PerfCounters *perf) {
+  auto body = benchCase.setup();
+  for (int i = 0; i < options.warmup; ++i) {
+    for (std::size_t op = 0; op < benchCase.batch; ++op) {
+      body();
+    }
+  }
+
+  std::vector<double> samples;
+  std::vector<double> totals(counterCount, 0);
+  if (perf) {
+    perf->clearScaled();
+  }
+  for (int i = 0; i < options.repetitions; ++i) {
+    if (perf) {
+      perf->start();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t op = 0; op < benchCase.batch; ++op) {
+      body();
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (perf) {
+      auto values = perf->stop();
+      for (std::size_t c = 0; c < counterCount; ++c) {
+        totals[c] += values[c];
+      }
+    }
+    samples.push_back(elapsed.count() / benchCase.batch);
+  }
+
+  Result result{&benchCase, 0, 0, 0, 0, std::nullopt, false};
+  std::sort(samples.begin(), samples.end());
+  auto n = samples.size();
+  result.minNs = samples.front();
+  result.medianNs = n % 2 ? samples[n / 2]
+                          : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  for (auto sample : samples) {
+    result.meanNs += sample / n;
+  }
+  for (auto sample : samples) {
+    result.stddevNs += (sample - result.meanNs) * (sample - result.meanNs);
+  }
+  result.stddevNs = n > 1 ? std::sqrt(result.stddevNs / (n - 1)) : 0;
+  if (perf) {
+    for (auto &total : totals) {
+      total /= double(n) * benchCase.batch;
+    }
+    result.counters = totals;
+    result.countersScaled = perf->scaled();
+  }
+  return result;
+}
+
+std::string escape(const std::string &text) {
+  std::string escaped;
+  for (auto c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+// One case per line, so that readBaseline() can parse the file line by line.
+void writeJson(std::ostream &out, const std::vector<Result> &results,
+               const Options &options) {
+  out << std::setprecision(6) << "{\n  \"repetitions\": "
+      << options.repetitions << ",\n  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    out << "    {\"component\": \"" << escape(r.benchCase->component)
+        << "\", \"name\": \"" << escape(r.benchCase->name)
+        << "\", \"batch\": " << r.benchCase->batch
+        << ", \"min_ns\": " << r.minNs << ", \"median_ns\": " << r.medianNs
+        << ", \"mean_ns\": " << r.meanNs << ", \"stddev_ns\": " << r.stddevNs;
+    if (r.counters) {
+      out << ", \"counters\": {";
+      for (std::size_t c = 0; c < counterCount; ++c) {
+        out << (c ? ", " : "") << "\"" << counterNames[c]
+            << "\": " << (*r.counters)[c];
+      }
+      out << "}, \"counters_scaled\": "
+          << (r.countersScaled ? "true" : "false");
+    }
+    out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+std::optional<std::string> field(const std::string &line,
+                                 const std::string &key) {
+  auto at = line.find("\"" + key + "\": ");
+  if (at == std::string::npos) {
+    return std::nullopt;
+  }
+  at += key.size() + 4;
+  if (line[at] == '"') {
+    auto end = line.find('"', at + 1);
+    return line.substr(at + 1, end - at - 1);
+  }
+  auto end = line.find_first_of(",}", at);
+  return line.substr(at, end - at);
+}
+
+// Median times by "component/name" from a file written by writeJson().
+std::map<std::string, double> readBaseline(const std::string &path) {
+  std::map<std::string, double> medians;
+  std::ifstream in(path);
+  for (std::string line; std::getline(in, line);) {
+    auto component = field(line, "component");
+    auto name = field(line, "name");
+    auto median = field(line, "median_ns");
+    if (component && name && median) {
+      medians[*component + "/" + *name] = std::stod(*median);
+    }
+  }
+  return medians;
+}
+
+bool compare(const std::vector<Result> &results,
+             const std::map<std::string, double> &baseline,
+             double threshold) {
+  bool regressed = false;
+  std::cerr << std::left << std::setw(40) << "case" << std::right
+            << std::setw(14) << "baseline ns" << std::setw(14) << "current ns"
+            << std::setw(10) << "change\n";
+  for (const auto &r : results) {
+    auto key = r.benchCase->component + "/" + r.benchCase->name;
+    auto old = baseline.find(key);
+    std::cerr << std::left << std::setw(40) << key << std::right
+              << std::setw(14);
+    if (old == baseline.end()) {
+      std::cerr << "-" << std::setw(14) << r.medianNs << std::setw(10)
+                << "new" << "\n";
+      continue;
+    }
+    double change = (r.medianNs / old->second - 1) * 100;
+    bool slower = change > threshold;
+    regressed = regressed || slower;
+    std::cerr << old->second << std::setw(14) << r.medianNs << std::setw(9)
+              << std::fixed << std::setprecision(1) << change << "%"
+              << std::defaultfloat << std::setprecision(6)
+              << (slower ? "  REGRESSION" : "") << "\n";
+  }
+  return regressed;
+}
+
+Options parse(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        throw std::invalid_argument(arg + " needs a value");
+      }
+      return argv[++i];
+    };
+    if (arg == "--filter") {
+      options.filter = value();
+    } else if (arg == "--repetitions") {
+      options.repetitions = std::max(1, std::stoi(value()));
+    } else if (arg == "--warmup") {
+      options.warmup = std::max(0, std::stoi(value()));
+    } else if (arg == "--counters") {
+      options.counters = true;
+    } else if (arg == "--out") {
+      options.out = value();
+    } else if (arg == "--baseline") {
+      options.baseline = value();
+    } else if (arg == "--threshold") {
+      options.threshold = std::stod(value());
+    } else {
+      throw std::invalid_argument("unknown option " + arg);
+    }
+  }
+  return options;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = parse(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 2;
+  }
+
+  std::optional<PerfCounters> perf;
+  if (options.counters) {
+    perf.emplace();
+    if (!perf->available()) {
+      std::cerr << "hardware counters unavailable, timing only\n";
+      perf.reset();
+    }
+  }
+
+  std::vector<Result> results;
+  NullBuffer null;
+  for (const auto &benchCase : Bench::registry()) {
+    auto fullName = benchCase.component + "/" + benchCase.name;
+    if (fullName.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    std::cerr << "running " << fullName << "\n";
+    auto *coutBuffer = std::cout.rdbuf(&null);
+    results.push_back(run(benchCase, options, perf ? &*perf : nullptr));
+    std::cout.rdbuf(coutBuffer);
+  }
+
+  if (options.out.empty()) {
+    writeJson(std::cout, results, options);
+  } else {
+    std::ofstream out(options.out);
+    writeJson(out, results, options);
+  }
+
+  if (!options.baseline.empty()) {
+    auto baseline = readBaseline(options.baseline);
+    if (baseline.empty()) {
+      std::cerr << "no results in baseline " << options.baseline << "\n";
+      return 2;
+    }
+    return compare(results, baseline, options.threshold) ? 1 : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Every program's main() is compiled out, so its classes can be linked into
+// the benchmark runner.
+#define CPP4SEM_NO_MAIN
+
+namespace Bench {
+// The operation being timed. One repetition calls it `batch` times.
+using Body = std::function<void()>;
+
+// A case prepares its data once (not timed) and returns the operation.
+struct Case {
+  std::string component;
+  std::string name;
+  std::size_t batch;
+  std::function<Body()> setup;
+};
+
+inline std::vector<Case> &registry() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+struct Registrar {
+  Registrar(std::string component, std::string name, std::size_t batch,
+            std::function<Body()> setup) {
+    registry().push_back({component, name, batch, setup});
+  }
+};
+
+// Keeps the compiler from discarding a result that is never read.
+template <typename T> void doNotOptimize(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+} // namespace Bench
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+// BENCH_CASE("set", "add_10k", 1) { ...setup...; return [=] { ...op... }; }
+#define BENCH_CASE(component, name, batch)                                    \
+  static Bench::Body BENCH_CONCAT(benchSetup, __LINE__)();                    \
+  static Bench::Registrar BENCH_CONCAT(benchRegistrar, __LINE__)(             \
+      component, name, batch, BENCH_CONCAT(benchSetup, __LINE__));            \
+  static Bench::Body BENCH_CONCAT(benchSetup, __LINE__)()
@@ -0,0 +1,33 @@
+#include "bench.h"
+
+#include "../t4.cpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+BENCH_CASE("compare", "sort_numbers_10k", 1) {
+  auto numbers = std::make_shared<std::vector<Number>>();
+  std::mt19937 rng(1);
+  for (int i = 0; i < 10000; ++i) {
+    numbers->emplace_back(static_cast<int>(rng()));
+  }
+  return [numbers] {
+    auto copy = *numbers;
+    std::sort(copy.begin(), copy.end());
+    Bench::doNotOptimize(copy);
+  };
+}
+
+BENCH_CASE("compare", "derived_operators", 100000) {
+  auto numbers = std::make_shared<std::vector<Number>>();
+  for (int i = 0; i < 4; ++i) {
+    numbers->emplace_back(i);
+  }
+  return [numbers] {
+    const auto &n = *numbers;
+    Bench::doNotOptimize((n[0] >= n[1]) + (n[2] <= n[3]) + (n[1] == n[1]) +
+                         (n[3] > n[2]) + (n[0] != n[3]));
+  };
+}
@@ -0,0 +1,16 @@
+#include "bench.h"
+
+#include "../t5.cpp"
+
+BENCH_CASE("log", "message", 10000) {
+  Log *log = Log::Instance();
+  return [log] { log->message(LOG_WARNING, "some warning"); };
+}
+
+BENCH_CASE("log", "print_10", 100) {
+  Log *log = Log::Instance();
+  for (int i = 0; i < 10; ++i) {
+    log->message(LOG_NORMAL, "normal loaded");
+  }
+  return [log] { log->print(); };
+}
@@ -0,0 +1,159 @@
+#include "bench.h"
+
+#include "../t6.cpp"
+
+namespace {
+std::shared_ptr<CheckPointBatch> randomRoute(std::size_t size) {
+  auto route = std::make_shared<CheckPointBatch>();
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> coord(-60, 60);
+  route->reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    route->push_back("cp", coord(rng), coord(rng), 1.0f, i % 4 == 0);
+  }
+  return route;
+}
+
+// The same checkpoints as randomRoute(), as CheckPoint objects.
+std::shared_ptr<std::vector<CheckPoint>> randomVectorRoute(std::size_t size) {
+  auto batch = randomRoute(size);
+  auto route = std::make_shared<std::vector<CheckPoint>>();
+  route->reserve(size);
+  for (std::size_t i = 0; i < batch->size(); ++i) {
+    route->push_back(batch->at(i));
+  }
+  return route;
+}
+
+// Penalty and distance reports for 64 routes of 10000 checkpoints on the
+// given number of threads.
+Bench::Body generateReportsOn(unsigned threads) {
+  auto routes = std::make_shared<std::vector<CheckPointBatch>>();
+  for (int i = 0; i < 64; ++i) {
+    routes->push_back(*randomRoute(10000));
+  }
+  return [routes, threads] {
+    auto reports = generateReports(
+        *routes,
+        {[] { return std::make_unique<PenaltyReportBuilder>(); },
+         [] { return std::make_unique<DistanceReportBuilder>(); }},
+        threads);
+    Bench::doNotOptimize(reports);
+  };
+}
+} // namespace
+
+BENCH_CASE("report", "penalty_batch_1m", 1) {
+  auto route = randomRoute(1000000);
+  return [route] {
+    PenaltyReportBuilder builder;
+    builder.addCheckpoints(*route);
+    Bench::doNotOptimize(builder);
+  };
+}
+
+BENCH_CASE("report", "distance_batch_1m", 1) {
+  auto route = randomRoute(1000000);
+  return [route] {
+    DistanceReportBuilder builder;
+    builder.addCheckpoints(*route);
+    Bench::doNotOptimize(builder);
+  };
+}
+
+BENCH_CASE("report", "print_batch_100k", 1) {
+  auto route = randomRoute(100000);
+  return [route] {
+    PrintReportBuilder builder;
+    builder.addCheckpoints(*route);
+    Bench::doNotOptimize(builder.reportView());
+  };
+}
+
+BENCH_CASE("report", "penalty_virtual_loop_100k", 1) {
+  auto route = randomVectorRoute(100000);
+  return [route] {
+    PenaltyReportBuilder builder;
+    ReportBuilder *base = opaqueBuilder(&builder);
+    base->ReportBuilder::addCheckpoints(*route);
+    Bench::doNotOptimize(builder);
+  };
+}
+
+BENCH_CASE("report", "penalty_static_loop_100k", 1) {
+  auto route = randomVectorRoute(100000);
+  return [route] {
+    PenaltyReportBuilder builder;
+    builder.addCheckpoints(*route);
+    Bench::doNotOptimize(builder);
+  };
+}
+
+BENCH_CASE("report", "composite_three_builders_100k", 1) {
+  auto route = randomRoute(100000);
+  return [route] {
+    PrintReportBuilder print;
+    PenaltyReportBuilder penalty;
+    DistanceReportBuilder distance;
+    CompositeReportBuilder composite({&print, &penalty, &distance});
+    composite.addCheckpoints(*route);
+    Bench::doNotOptimize(composite);
+  };
+}
+
+BENCH_CASE("report", "generate_reports_64_routes", 1) {
+  return generateReportsOn(std::thread::hardware_concurrency());
+}
+
+BENCH_CASE("report", "generate_reports_1_thread", 1) {
+  return generateReportsOn(1);
+}
+
+BENCH_CASE("report", "generate_reports_2_threads", 1) {
+  return generateReportsOn(2);
+}
+
+BENCH_CASE("report", "generate_reports_4_threads", 1) {
+  return generateReportsOn(4);
+}
+
+BENCH_CASE("report", "generate_reports_8_threads", 1) {
+  return generateReportsOn(8);
+}
+
+BENCH_CASE("report", "composite_vector_route_100k", 1) {
+  auto route = randomVectorRoute(100000);
+  return [route] {
+    PenaltyReportBuilder penalty;
+    DistanceReportBuilder distance;
+    CompositeReportBuilder composite({&penalty, &distance});
+    composite.addCheckpoints(*route);
+    Bench::doNotOptimize(composite);
+  };
+}
+
+BENCH_CASE("report", "track_match_100k_fixes", 1) {
+  auto route = std::make_shared<CheckPointBatch>();
+  std::mt19937 rng(5);
+  std::normal_distribution<float> step(0, 0.01f);
+  float lat = 55.75f, lon = 37.61f;
+  for (int i = 0; i < 10000; ++i) {
+    lat += step(rng) * 10;
+    lon += step(rng) * 10;
+    route->push_back("cp", lat, lon, 10, i % 10 == 0);
+  }
+  auto fixes = std::make_shared<std::vector<float>>();
+  for (int i = 0; i < 100000; ++i) {
+    auto cp = static_cast<std::size_t>(i) / 10;
+    fixes->push_back(route->latitude()[cp] + step(rng));
+    fixes->push_back(route->longitude()[cp] + step(rng));
+  }
+  auto matcher = std::make_shared<TrackMatcher>(*route, 0.5);
+  return [route, fixes, matcher] {
+    matcher->reset();
+    for (std::size_t i = 0; i < fixes->size(); i += 2) {
+      matcher->addFix((*fixes)[i], (*fixes)[i + 1]);
+    }
+    Bench::doNotOptimize(matcher->visited());
+  };
+}
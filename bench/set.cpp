@@ -0,0 +1,116 @@
+#include "bench.h"
+
+#include "../t7.cpp"
+
+namespace {
+std::vector<int> randomInts(std::size_t count, int range, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::vector<int> values(count);
+  for (auto &value : values) {
+    value = static_cast<int>(rng() % range);
+  }
+  return values;
+}
+} // namespace
+
+BENCH_CASE("set", "add_10k_sparse", 1) {
+  auto values = randomInts(10000, 1 << 30, 1);
+  return [values] {
+    Set<int> set{};
+    for (auto value : values) {
+      set.add(value);
+    }
+    Bench::doNotOptimize(set);
+  };
+}
+
+BENCH_CASE("set", "add_10k_dense", 1) {
+  auto values = randomInts(10000, 20000, 2);
+  return [values] {
+    Set<int> set{};
+    for (auto value : values) {
+      set.add(value);
+    }
+    Bench::doNotOptimize(set);
+  };
+}
+
+BENCH_CASE("set", "insert_range_1m", 1) {
+  auto values = randomInts(1000000, 1 << 30, 3);
+  return [values] {
+    Set<int> set(values.begin(), values.end());
+    Bench::doNotOptimize(set);
+  };
+}
+
+BENCH_CASE("set", "contains_hash_100k", 100000) {
+  auto set = std::make_shared<Set<int>>();
+  for (auto value : randomInts(100000, 1 << 30, 4)) {
+    set->add(value);
+  }
+  auto probes =
+      std::make_shared<std::vector<int>>(randomInts(4096, 1 << 30, 5));
+  auto i = std::make_shared<std::size_t>(0);
+  return [set, probes, i] {
+    Bench::doNotOptimize(set->contains((*probes)[++*i & 4095]));
+  };
+}
+
+BENCH_CASE("set", "oscillate_at_threshold", 10000) {
+  auto set = std::make_shared<Set<double>>();
+  for (int i = 0; i < 32; ++i) {
+    set->add(i * 0.5);
+  }
+  return [set] {
+    set->add(100.0);
+    set->remove(100.0);
+  };
+}
+
+BENCH_CASE("set", "intersect_sorted_doubles_100k", 1) {
+  std::vector<double> a, b;
+  for (auto value : randomInts(100000, 1 << 20, 6)) {
+    a.push_back(value * 0.5);
+  }
+  for (auto value : randomInts(100000, 1 << 20, 7)) {
+    b.push_back(value * 0.5);
+  }
+  auto left = std::make_shared<Set<double>>(a.begin(), a.end());
+  auto right = std::make_shared<Set<double>>(b.begin(), b.end());
+  for (int i = 0; i < 100000; ++i) {
+    left->contains(i);
+    right->contains(i);
+  }
+  left->add(-1);
+  right->add(-1);
+  return [left, right] { Bench::doNotOptimize(left->intersect(*right)); };
+}
+
+BENCH_CASE("set", "intersect_bitmap_1m", 1) {
+  auto a = randomInts(1000000, 4000000, 8);
+  auto b = randomInts(1000000, 4000000, 9);
+  auto left = std::make_shared<Set<int>>(a.begin(), a.end());
+  auto right = std::make_shared<Set<int>>(b.begin(), b.end());
+  return [left, right] { Bench::doNotOptimize(left->intersect(*right)); };
+}
+
+BENCH_CASE("set", "unite_bitmap_1m", 1) {
+  auto a = randomInts(1000000, 4000000, 10);
+  auto b = randomInts(1000000, 4000000, 11);
+  auto left = std::make_shared<Set<int>>(a.begin(), a.end());
+  auto right = std::make_shared<Set<int>>(b.begin(), b.end());
+  return [left, right] { Bench::doNotOptimize(left->unite(*right)); };
+}
+
+BENCH_CASE("set", "concurrent_contains", 100000) {
+  auto set = std::make_shared<ConcurrentSet<int>>();
+  for (auto value : randomInts(100000, 1 << 30, 12)) {
+    set->add(value);
+  }
+  auto probes =
+      std::make_shared<std::vector<int>>(randomInts(4096, 1 << 30, 13));
+  auto i = std::make_shared<std::size_t>(0);
+  return [set, probes, i] {
+    Bench::doNotOptimize(set->contains((*probes)[++*i & 4095]));
+  };
+}
@@ -0,0 +1,30 @@
+#include "bench.h"
+
+#include "../t3.cpp"
+
+#include <memory>
+
+BENCH_CASE("typemap", "add_get_double", 100000) {
+  auto map = std::make_shared<TypeMap<int, DataA, double, DataB>>();
+  return [map] {
+    map->AddValue<double>(3.14);
+    Bench::doNotOptimize(map->GetValue<double>());
+  };
+}
+
+BENCH_CASE("typemap", "add_get_string", 100000) {
+  auto map = std::make_shared<TypeMap<int, DataA, double, DataB>>();
+  return [map] {
+    map->AddValue<DataA>({"Hello, TypeMap!"});
+    Bench::doNotOptimize(map->GetValue<DataA>());
+  };
+}
+
+BENCH_CASE("typemap", "contains_remove", 100000) {
+  auto map = std::make_shared<TypeMap<int, DataA, double, DataB>>();
+  return [map] {
+    map->AddValue<int>(42);
+    Bench::doNotOptimize(map->Contains<int>());
+    map->RemoveValue<int>();
+  };
+}
@@ -0,0 +1,38 @@
+#include "bench.h"
+
+#include "../t1.cpp"
+
+BENCH_CASE("users", "create_delete_user", 1000) {
+  auto manager = std::make_shared<UserManager>();
+  return [manager] {
+    manager->createUser(1, "user", "description");
+    manager->deleteUser(1);
+  };
+}
+
+// Group keeps a weak_ptr to every user ever added, so the group is replaced
+// once per batch to keep its member list the same size in every repetition.
+BENCH_CASE("users", "create_user_in_group", 1000) {
+  auto manager = std::make_shared<UserManager>();
+  manager->createGroup(1);
+  auto id = std::make_shared<int>(0);
+  return [manager, id] {
+    manager->createUser(++*id, "user", "description", 1);
+    manager->deleteUser(*id);
+    if (*id % 1000 == 0) {
+      manager->deleteGroup(1);
+      manager->createGroup(1);
+    }
+  };
+}
+
+BENCH_CASE("users", "find_user_10k", 10000) {
+  auto manager = std::make_shared<UserManager>();
+  for (int id = 0; id < 10000; ++id) {
+    manager->createUser(id, "user", "description");
+  }
+  auto id = std::make_shared<int>(0);
+  return [manager, id] {
+    Bench::doNotOptimize(manager->findUser(*id = (*id + 7919) % 10000));
+  };
+}
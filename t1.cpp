@@ -181,6 +181,7 @@ private:
   std::map<int, std::shared_ptr<Group>> groups;
 };
 
+#ifndef CPP4SEM_NO_MAIN
 int main() {
   UserManager userManager;
 
@@ -325,3 +326,4 @@ int main() {
 
   return 0;
 }
+#endif
@@ -106,6 +106,7 @@ struct DataA {
 struct DataB {
   int value;
 };
+#ifndef CPP4SEM_NO_MAIN
 int main() {
   TypeMap<int, DataA, double, DataB> myTypeMap;
   // Добавление элементов в контейнер
@@ -133,3 +134,4 @@ int main() {
   myTypeMap.RemoveValue<double>();
   return 0;
 }
+#endif
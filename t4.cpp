@@ -45,6 +45,7 @@ private:
   int m_value;
 };
 
+#ifndef CPP4SEM_NO_MAIN
 int main() {
   Number one{1};
   Number two{2};
@@ -58,3 +59,4 @@ int main() {
   std::cout << "Count: " << counter<Number>::count << std::endl;
   return 0;
 }
+#endif
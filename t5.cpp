@@ -54,6 +54,7 @@ private:
 
 Log *Log::logInstance = nullptr;
 
+#ifndef CPP4SEM_NO_MAIN
 int main(void) {
   Log *log = Log::Instance();
   log->message(LOG_NORMAL, "normal loaded");
@@ -62,3 +63,4 @@ int main(void) {
   log->print();
   return 0;
 }
+#endif
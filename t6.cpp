@@ -1,8 +1,30 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <random>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 struct CheckPoint {
   std::string name;
   float latitude;
@@ -19,65 +41,1143 @@ struct CheckPoint {
         required(false) {};
 };
 
+// Columnar storage for large routes: every field lives in its own array and
+// names are packed into one string pool, so kernels stream only the columns
+// they need.
+class CheckPointBatch {
+public:
+  CheckPointBatch() = default;
+  explicit CheckPointBatch(const std::vector<CheckPoint> &route) {
+    reserve(route.size());
+    for (const auto &cp : route) {
+      push_back(cp);
+    }
+  }
+
+  void reserve(std::size_t n) {
+    latitudes.reserve(n);
+    longitudes.reserve(n);
+    penalties.reserve(n);
+    requiredFlags.reserve(n);
+    nameOffsets.reserve(n + 1);
+  }
+
+  void push_back(const CheckPoint &cp) {
+    push_back(cp.name, cp.latitude, cp.longitude, cp.penalty, cp.required);
+  }
+
+  void push_back(std::string_view name, float latitude, float longitude,
+                 float penalty, bool required) {
+    namePool.append(name);
+    nameOffsets.push_back(static_cast<std::uint32_t>(namePool.size()));
+    latitudes.push_back(latitude);
+    longitudes.push_back(longitude);
+    penalties.push_back(penalty);
+    requiredFlags.push_back(required ? 1 : 0);
+  }
+
+  std::size_t size() const { return latitudes.size(); }
+
+  std::string_view name(std::size_t i) const {
+    return std::string_view(namePool).substr(
+        nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+  }
+  const float *latitude() const { return latitudes.data(); }
+  const float *longitude() const { return longitudes.data(); }
+  const float *penalty() const { return penalties.data(); }
+  const std::uint8_t *required() const { return requiredFlags.data(); }
+
+  CheckPoint at(std::size_t i) const {
+    if (requiredFlags[i]) {
+      return CheckPoint(std::string(name(i)), latitudes[i], longitudes[i]);
+    }
+    return CheckPoint(std::string(name(i)), latitudes[i], longitudes[i],
+                      penalties[i]);
+  }
+
+private:
+  std::vector<float> latitudes;
+  std::vector<float> longitudes;
+  std::vector<float> penalties;
+  std::vector<std::uint8_t> requiredFlags;
+  std::string namePool;
+  std::vector<std::uint32_t> nameOffsets{0};
+};
+
+// Sum of penalties of the optional checkpoints.
+float sumPenalties(const float *penalty, const std::uint8_t *required,
+                   std::size_t n) {
+  std::size_t i = 0;
+  float total = 0;
+#if defined(__SSE2__)
+  // Eight checkpoints per step: the required flags are widened to 32-bit
+  // lanes and compared with zero, giving a mask that keeps only the
+  // penalties of optional checkpoints.
+  const __m128i zero = _mm_setzero_si128();
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    __m128i flags = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(required + i)),
+        zero);
+    __m128i optional0 = _mm_cmpeq_epi32(_mm_unpacklo_epi16(flags, zero), zero);
+    __m128i optional1 = _mm_cmpeq_epi32(_mm_unpackhi_epi16(flags, zero), zero);
+    acc0 = _mm_add_ps(acc0, _mm_and_ps(_mm_castsi128_ps(optional0),
+                                       _mm_loadu_ps(penalty + i)));
+    acc1 = _mm_add_ps(acc1, _mm_and_ps(_mm_castsi128_ps(optional1),
+                                       _mm_loadu_ps(penalty + i + 4)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+  total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+  for (; i < n; ++i) {
+    total += required[i] ? 0.0f : penalty[i];
+  }
+  return total;
+}
+
+constexpr double earthRadiusKm = 6371.0;
+constexpr double degToRad = 3.14159265358979323846 / 180.0;
+
+// Great-circle distance in kilometres between two points given in degrees.
+double haversine(float lat1, float lon1, float lat2, float lon2) {
+  double dLat = (lat2 - lat1) * degToRad;
+  double dLon = (lon2 - lon1) * degToRad;
+  double sLat = std::sin(dLat / 2);
+  double sLon = std::sin(dLon / 2);
+  double a = sLat * sLat + std::cos(lat1 * degToRad) *
+                               std::cos(lat2 * degToRad) * sLon * sLon;
+  return 2 * earthRadiusKm * std::asin(std::sqrt(std::min(a, 1.0)));
+}
+
+#if defined(__SSE2__)
+namespace Simd {
+inline __m128d select(__m128d mask, __m128d a, __m128d b) {
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+// sin and cos of two angles in radians, to within a few ulp of libm. The
+// angle is reduced to [-pi/4, pi/4] around the nearest multiple k of pi/2
+// (pi/2 is split in three parts so k * part is exact), the Cephes
+// polynomials are evaluated there, and bits 0 and 1 of k pick the swap and
+// signs. Angles beyond a million radians go to libm.
+inline void sinCos(__m128d x, __m128d &s, __m128d &c) {
+  constexpr double limit = 1e6;
+  const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffff));
+  if (_mm_movemask_pd(_mm_cmpgt_pd(_mm_and_pd(x, absMask),
+                                   _mm_set1_pd(limit)))) {
+    double in[2], sOut[2], cOut[2];
+    _mm_storeu_pd(in, x);
+    for (int l = 0; l < 2; ++l) {
+      sOut[l] = std::sin(in[l]);
+      cOut[l] = std::cos(in[l]);
+    }
+    s = _mm_loadu_pd(sOut);
+    c = _mm_loadu_pd(cOut);
+    return;
+  }
+
+  __m128i k =
+      _mm_cvtpd_epi32(_mm_mul_pd(x, _mm_set1_pd(0.63661977236758134308)));
+  __m128d kd = _mm_cvtepi32_pd(k);
+  __m128d r =
+      _mm_sub_pd(x, _mm_mul_pd(kd, _mm_set1_pd(1.57079625129699707031)));
+  r = _mm_sub_pd(r, _mm_mul_pd(kd, _mm_set1_pd(7.54978941586159635335e-8)));
+  r = _mm_sub_pd(r, _mm_mul_pd(kd, _mm_set1_pd(5.39030285815811905290e-15)));
+  __m128d z = _mm_mul_pd(r, r);
+
+  __m128d ps = _mm_set1_pd(1.58962301576546568060e-10);
+  ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-2.50507477628578072866e-8));
+  ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(2.75573136213857245213e-6));
+  ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.98412698295895385996e-4));
+  ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(8.33333333332211858878e-3));
+  ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.66666666666666307295e-1));
+  __m128d sinR = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+  __m128d pc = _mm_set1_pd(-1.13585365213876817300e-11);
+  pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(2.08757008419747316778e-9));
+  pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-2.75573141792967388112e-7));
+  pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(2.48015872888517045348e-5));
+  pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-1.38888888888730564116e-3));
+  pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(4.16666666666665929218e-2));
+  __m128d cosR = _mm_add_pd(
+      _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(z, _mm_set1_pd(0.5))),
+      _mm_mul_pd(_mm_mul_pd(z, z), pc));
+
+  // Each k into both halves of its 64-bit lane.
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+  __m128i q = _mm_shuffle_epi32(k, _MM_SHUFFLE(1, 1, 0, 0));
+  __m128d swap = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+  __m128d sinSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(q, two), 62));
+  __m128d cosSign = _mm_castsi128_pd(
+      _mm_slli_epi64(_mm_and_si128(_mm_add_epi32(q, one), two), 62));
+  s = _mm_xor_pd(select(swap, cosR, sinR), sinSign);
+  c = _mm_xor_pd(select(swap, sinR, cosR), cosSign);
+}
+
+// Taylor coefficients of asin(t) / t in powers of t^2.
+struct AsinSeries {
+  static constexpr int terms = 24;
+  double c[terms];
+
+  constexpr AsinSeries() : c() {
+    c[0] = 1;
+    for (int n = 1; n < terms; ++n) {
+      c[n] = c[n - 1] * (2 * n - 1) * (2 * n - 1) / (2 * n * (2 * n + 1));
+    }
+  }
+};
+inline constexpr AsinSeries asinSeries;
+
+// asin of two values in [0, 1]. Above 1/2 the identity
+// asin(h) = pi/2 - 2 asin(sqrt((1 - h) / 2)) brings the argument back to
+// [0, 1/2], where the series is exact to double precision.
+inline __m128d asin(__m128d h) {
+  h = _mm_min_pd(h, _mm_set1_pd(1.0));
+  __m128d big = _mm_cmpgt_pd(h, _mm_set1_pd(0.5));
+  __m128d t = select(
+      big,
+      _mm_sqrt_pd(_mm_mul_pd(_mm_sub_pd(_mm_set1_pd(1.0), h),
+                             _mm_set1_pd(0.5))),
+      h);
+  // p(z) = c[1] + c[2] z + ... + c[23] z^22, split into the odd and even
+  // coefficients as polynomials in z^2 so the two Horner chains overlap.
+  __m128d z = _mm_mul_pd(t, t);
+  __m128d z2 = _mm_mul_pd(z, z);
+  constexpr int last = AsinSeries::terms - 1;
+  __m128d odd = _mm_set1_pd(asinSeries.c[last]);
+  __m128d even = _mm_set1_pd(asinSeries.c[last - 1]);
+  for (int n = last - 2; n > 0; n -= 2) {
+    odd = _mm_add_pd(_mm_mul_pd(odd, z2), _mm_set1_pd(asinSeries.c[n]));
+    if (n > 1) {
+      even = _mm_add_pd(_mm_mul_pd(even, z2),
+                        _mm_set1_pd(asinSeries.c[n - 1]));
+    }
+  }
+  __m128d p = _mm_add_pd(_mm_mul_pd(even, z), odd);
+  __m128d r = _mm_add_pd(t, _mm_mul_pd(_mm_mul_pd(t, z), p));
+  return select(big,
+                _mm_sub_pd(_mm_set1_pd(1.57079632679489661923),
+                           _mm_add_pd(r, r)),
+                r);
+}
+} // namespace Simd
+#endif
+
+// Length of the polyline through n points. Same great-circle distance as
+// haversine(), but computed as 2*asin(chord/2) over unit vectors, so
+// trigonometry is paid once per point instead of per pair. Works in L1-sized
+// blocks. With SSE2, two points or pairs are processed per step with the
+// polynomial Simd::sinCos and Simd::asin, which cover every pair distance;
+// only coordinates beyond 1e6 rad go to libm.
+double routeDistance(const float *latitude, const float *longitude,
+                     std::size_t n) {
+  constexpr std::size_t block = 512;
+  double x[block + 1], y[block + 1], z[block + 1];
+  double total = 0;
+  for (std::size_t start = 0; start + 1 < n; start += block) {
+    std::size_t count = std::min(block + 1, n - start);
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d toRad = _mm_set1_pd(degToRad);
+    for (; i + 2 <= count; i += 2) {
+      __m128d lat = _mm_mul_pd(
+          _mm_set_pd(latitude[start + i + 1], latitude[start + i]), toRad);
+      __m128d lon = _mm_mul_pd(
+          _mm_set_pd(longitude[start + i + 1], longitude[start + i]), toRad);
+      __m128d sLat, cLat, sLon, cLon;
+      Simd::sinCos(lat, sLat, cLat);
+      Simd::sinCos(lon, sLon, cLon);
+      _mm_storeu_pd(x + i, _mm_mul_pd(cLat, cLon));
+      _mm_storeu_pd(y + i, _mm_mul_pd(cLat, sLon));
+      _mm_storeu_pd(z + i, sLat);
+    }
+#endif
+    for (; i < count; ++i) {
+      double lat = latitude[start + i] * degToRad;
+      double lon = longitude[start + i] * degToRad;
+      double c = std::cos(lat);
+      x[i] = c * std::cos(lon);
+      y[i] = c * std::sin(lon);
+      z[i] = std::sin(lat);
+    }
+
+    i = 0;
+#if defined(__SSE2__)
+    __m128d sum = _mm_setzero_pd();
+    for (; i + 3 <= count; i += 2) {
+      __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i + 1), _mm_loadu_pd(x + i));
+      __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i + 1), _mm_loadu_pd(y + i));
+      __m128d dz = _mm_sub_pd(_mm_loadu_pd(z + i + 1), _mm_loadu_pd(z + i));
+      __m128d h = _mm_mul_pd(
+          _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx),
+                                            _mm_mul_pd(dy, dy)),
+                                 _mm_mul_pd(dz, dz))),
+          _mm_set1_pd(0.5));
+      sum = _mm_add_pd(sum, Simd::asin(h));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, sum);
+    total += lanes[0] + lanes[1];
+#endif
+    for (; i + 1 < count; ++i) {
+      double dx = x[i + 1] - x[i];
+      double dy = y[i + 1] - y[i];
+      double dz = z[i + 1] - z[i];
+      double h = std::sqrt(dx * dx + dy * dy + dz * dz) * 0.5;
+      total += std::asin(std::min(h, 1.0));
+    }
+  }
+  return 2 * earthRadiusKm * total;
+}
+
 class ReportBuilder {
 public:
   virtual void addCheckpoint(const CheckPoint &CheckPoint) = 0;
   virtual void addCheckpoints(const std::vector<CheckPoint> &route) {
-    for (auto cp : route) {
+    for (const auto &cp : route) {
       addCheckpoint(cp);
     }
   };
+  // Feeds checkpoints [first, last) of a route, in order.
+  virtual void addCheckpoints(const std::vector<CheckPoint> &route,
+                              std::size_t first, std::size_t last) {
+    for (auto i = first; i < last; ++i) {
+      addCheckpoint(route[i]);
+    }
+  }
+
+  void addCheckpoints(const CheckPointBatch &batch) {
+    addCheckpoints(batch, 0, batch.size());
+  }
+  // Feeds checkpoints [first, last) of a batch, in order.
+  virtual void addCheckpoints(const CheckPointBatch &batch, std::size_t first,
+                              std::size_t last) {
+    for (auto i = first; i < last; ++i) {
+      addCheckpoint(batch.at(i));
+    }
+  }
 
   virtual std::string GetReport() = 0;
+
+  virtual ~ReportBuilder() {};
 };
 
-class PrintReportBuilder : public ReportBuilder {
+// Static-dispatch base for builders. Derived provides
+// add(const CheckPoint &) and may provide addRange(batch, first, last); the
+// route loops are instantiated per Derived, so the per-checkpoint call is
+// inlined. The virtual ReportBuilder interface is kept as a thin adapter.
+template <typename D> class StaticReportBuilder : public ReportBuilder {
 public:
-  void addCheckpoint(const CheckPoint &cp) override {
-    std::ostringstream ss;
-    ss << "CheckPoint " << cp.name << ": (" << cp.latitude << ", "
-       << cp.longitude << "), penalty: ";
-    if (cp.required) {
-      ss << "failure of SU\n";
-    } else {
-      ss << cp.penalty << "\n";
+  using ReportBuilder::addCheckpoints;
+
+  void addCheckpoint(const CheckPoint &cp) override { self().add(cp); }
+
+  void addCheckpoints(const std::vector<CheckPoint> &route) override {
+    for (const auto &cp : route) {
+      self().add(cp);
+    }
+  }
+
+  void addCheckpoints(const std::vector<CheckPoint> &route, std::size_t first,
+                      std::size_t last) override {
+    for (auto i = first; i < last; ++i) {
+      self().add(route[i]);
     }
-    report += ss.str();
   }
 
-  std::string GetReport() override { return report; }
+  void addCheckpoints(const CheckPointBatch &batch, std::size_t first,
+                      std::size_t last) override {
+    self().addRange(batch, first, last);
+  }
+
+  void addRange(const CheckPointBatch &batch, std::size_t first,
+                std::size_t last) {
+    for (auto i = first; i < last; ++i) {
+      self().add(batch.at(i));
+    }
+  }
 
 private:
-  std::string report = "";
+  D &self() { return static_cast<D &>(*this); }
 };
 
-class PenaltyReportBuilder : public ReportBuilder {
+// Destination for formatted report text.
+class ReportSink {
 public:
-  void addCheckpoint(const CheckPoint &cp) override {
+  virtual void write(const char *data, std::size_t size) = 0;
+
+  virtual ~ReportSink() {};
+};
+
+class StringSink : public ReportSink {
+public:
+  StringSink(std::string &out) : out(out) {};
+
+  void write(const char *data, std::size_t size) override {
+    out.append(data, size);
+  }
+
+private:
+  std::string &out;
+};
+
+// Writes to a caller-supplied fixed buffer; text that does not fit is
+// dropped and reported by truncated().
+class BufferSink : public ReportSink {
+public:
+  BufferSink(char *data, std::size_t capacity)
+      : data(data), capacity(capacity) {};
+
+  void write(const char *text, std::size_t size) override {
+    auto n = std::min(size, capacity - used);
+    std::memcpy(data + used, text, n);
+    used += n;
+    dropped = dropped || n < size;
+  }
+
+  std::size_t size() const { return used; }
+  bool truncated() const { return dropped; }
+
+private:
+  char *data;
+  std::size_t capacity;
+  std::size_t used = 0;
+  bool dropped = false;
+};
+
+// Writes to a POSIX file descriptor, which is not closed.
+class FdSink : public ReportSink {
+public:
+  FdSink(int fd) : fd(fd) {};
+
+  void write(const char *data, std::size_t size) override {
+    while (size > 0) {
+      auto n = ::write(fd, data, size);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(), "FdSink");
+      }
+      data += n;
+      size -= static_cast<std::size_t>(n);
+    }
+  }
+
+private:
+  int fd;
+};
+
+// Reusable append-only character buffer. Without a sink it grows on demand;
+// with a sink it keeps its capacity, flushes to the sink when full and
+// flushes the rest when destroyed.
+class ReportBuffer {
+public:
+  ReportBuffer(std::size_t capacity = 64 * 1024, ReportSink *sink = nullptr)
+      : data(new char[capacity]), capacity(capacity), sink(sink) {};
+
+  ReportBuffer(ReportBuffer &&other) noexcept
+      : data(std::move(other.data)),
+        capacity(std::exchange(other.capacity, 0)),
+        used(std::exchange(other.used, 0)),
+        sink(std::exchange(other.sink, nullptr)) {};
+
+  ReportBuffer &operator=(ReportBuffer &&other) {
+    if (this != &other) {
+      flush();
+      data = std::move(other.data);
+      capacity = std::exchange(other.capacity, 0);
+      used = std::exchange(other.used, 0);
+      sink = std::exchange(other.sink, nullptr);
+    }
+    return *this;
+  }
+
+  // A sink that throws here cannot report it, so the tail is lost; call
+  // flush() first to see write errors.
+  ~ReportBuffer() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  void append(std::string_view text) {
+    if (sink && text.size() > capacity) {
+      flush();
+      sink->write(text.data(), text.size());
+      return;
+    }
+    std::memcpy(reserve(text.size()), text.data(), text.size());
+    used += text.size();
+  }
+
+  // Same text as `std::ostream << value` with default flags (%g, 6 digits).
+  void append(float value) {
+    char *first = reserve(maxFloatChars);
+    auto result = std::to_chars(first, first + maxFloatChars, value,
+                                std::chars_format::general, 6);
+    used += static_cast<std::size_t>(result.ptr - first);
+  }
+
+  void flush() {
+    if (sink && used > 0) {
+      sink->write(data.get(), used);
+    }
+    used = 0;
+  }
+
+  void clear() { used = 0; }
+
+  bool hasSink() const { return sink; }
+
+  std::string_view view() const { return std::string_view(data.get(), used); }
+
+private:
+  static constexpr std::size_t maxFloatChars = 32;
+  std::unique_ptr<char[]> data;
+  std::size_t capacity;
+  std::size_t used = 0;
+  ReportSink *sink;
+
+  char *reserve(std::size_t n) {
+    if (used + n > capacity) {
+      if (sink) {
+        flush();
+      }
+      if (used + n > capacity) {
+        auto newCapacity = std::max(capacity * 2, used + n);
+        std::unique_ptr<char[]> newData(new char[newCapacity]);
+        if (used > 0) {
+          std::memcpy(newData.get(), data.get(), used);
+        }
+        data.swap(newData);
+        capacity = newCapacity;
+      }
+    }
+    return data.get() + used;
+  }
+};
+
+class PrintReportBuilder final
+    : public StaticReportBuilder<PrintReportBuilder> {
+public:
+  PrintReportBuilder() = default;
+  // Streams the report to sink every time the internal buffer fills up, and
+  // the rest on flush(), GetReport() or destruction.
+  PrintReportBuilder(ReportSink &sink) : buffer(64 * 1024, &sink) {};
+
+  void add(const CheckPoint &cp) {
+    append(cp.name, cp.latitude, cp.longitude, cp.penalty, cp.required);
+  }
+
+  void addRange(const CheckPointBatch &batch, std::size_t first,
+                std::size_t last) {
+    for (auto i = first; i < last; ++i) {
+      append(batch.name(i), batch.latitude()[i], batch.longitude()[i],
+             batch.penalty()[i], batch.required()[i]);
+    }
+  }
+
+  // Report text not yet flushed to a sink, without copying it.
+  std::string_view reportView() const { return buffer.view(); }
+
+  // Moves the buffered text to the sink the builder was created with.
+  void flush() { buffer.flush(); }
+
+  // Moves the buffered text to an arbitrary sink.
+  void writeReport(ReportSink &sink) {
+    auto text = buffer.view();
+    sink.write(text.data(), text.size());
+    buffer.clear();
+  }
+
+  // With a sink the report has been streamed there: the remaining text is
+  // flushed to it and an empty string is returned.
+  std::string GetReport() override {
+    if (buffer.hasSink()) {
+      buffer.flush();
+      return "";
+    }
+    return std::string(buffer.view());
+  }
+
+private:
+  ReportBuffer buffer;
+
+  void append(std::string_view name, float latitude, float longitude,
+              float penalty, bool required) {
+    buffer.append("CheckPoint ");
+    buffer.append(name);
+    buffer.append(": (");
+    buffer.append(latitude);
+    buffer.append(", ");
+    buffer.append(longitude);
+    buffer.append("), penalty: ");
+    if (required) {
+      buffer.append("failure of SU\n");
+    } else {
+      buffer.append(penalty);
+      buffer.append("\n");
+    }
+  }
+};
+
+class PenaltyReportBuilder final
+    : public StaticReportBuilder<PenaltyReportBuilder> {
+public:
+  void add(const CheckPoint &cp) {
     if (!cp.required) {
       penalty += cp.penalty;
     }
   }
 
+  void addRange(const CheckPointBatch &batch, std::size_t first,
+                std::size_t last) {
+    penalty += sumPenalties(batch.penalty() + first, batch.required() + first,
+                            last - first);
+  }
+
   std::string GetReport() override { return std::to_string(penalty); }
 
 private:
   float penalty = 0;
 };
 
-int main() {
+class DistanceReportBuilder final
+    : public StaticReportBuilder<DistanceReportBuilder> {
+public:
+  void add(const CheckPoint &cp) {
+    if (hasLast) {
+      distance += haversine(lastLatitude, lastLongitude, cp.latitude,
+                            cp.longitude);
+    }
+    setLast(cp.latitude, cp.longitude);
+  }
+
+  void addRange(const CheckPointBatch &batch, std::size_t first,
+                std::size_t last) {
+    if (first >= last) {
+      return;
+    }
+    const float *lat = batch.latitude();
+    const float *lon = batch.longitude();
+    if (hasLast) {
+      distance +=
+          haversine(lastLatitude, lastLongitude, lat[first], lon[first]);
+    }
+    distance += routeDistance(lat + first, lon + first, last - first);
+    setLast(lat[last - 1], lon[last - 1]);
+  }
+
+  std::string GetReport() override { return std::to_string(distance); }
+
+private:
+  double distance = 0;
+  float lastLatitude = 0;
+  float lastLongitude = 0;
+  bool hasLast = false;
+
+  void setLast(float latitude, float longitude) {
+    lastLatitude = latitude;
+    lastLongitude = longitude;
+    hasLast = true;
+  }
+};
+
+// Feeds several builders in one pass over the route. Routes and batches are
+// walked in chunks small enough to stay in cache, and each builder runs its
+// own loop or kernel over a chunk before the next builder gets it. Builders
+// are not owned.
+class CompositeReportBuilder : public ReportBuilder {
+public:
+  using ReportBuilder::addCheckpoints;
+
+  CompositeReportBuilder(std::vector<ReportBuilder *> builders)
+      : builders(builders) {};
+
+  void addCheckpoint(const CheckPoint &cp) override {
+    for (auto builder : builders) {
+      builder->addCheckpoint(cp);
+    }
+  }
+
+  void addCheckpoints(const std::vector<CheckPoint> &route) override {
+    addCheckpoints(route, 0, route.size());
+  }
+
+  void addCheckpoints(const std::vector<CheckPoint> &route, std::size_t first,
+                      std::size_t last) override {
+    for (auto chunk = first; chunk < last; chunk += chunkSize) {
+      auto chunkEnd = std::min(chunk + chunkSize, last);
+      for (auto builder : builders) {
+        builder->addCheckpoints(route, chunk, chunkEnd);
+      }
+    }
+  }
+
+  void addCheckpoints(const CheckPointBatch &batch, std::size_t first,
+                      std::size_t last) override {
+    for (auto chunk = first; chunk < last; chunk += chunkSize) {
+      auto chunkEnd = std::min(chunk + chunkSize, last);
+      for (auto builder : builders) {
+        builder->addCheckpoints(batch, chunk, chunkEnd);
+      }
+    }
+  }
+
+  // Reports of all builders, in the order they were given.
+  std::vector<std::string> GetReports() {
+    std::vector<std::string> reports;
+    reports.reserve(builders.size());
+    for (auto builder : builders) {
+      reports.push_back(builder->GetReport());
+    }
+    return reports;
+  }
+
+  std::string GetReport() override {
+    std::string report;
+    for (const auto &part : GetReports()) {
+      report += part;
+      report += "\n";
+    }
+    return report;
+  }
+
+private:
+  static constexpr std::size_t chunkSize = 4096;
+  std::vector<ReportBuilder *> builders;
+};
+
+using ReportBuilderFactory = std::function<std::unique_ptr<ReportBuilder>()>;
+
+// Builds every report type for every route, spreading routes over a pool of
+// threads. reports[r][k] is the report of factories[k] for routes[r], so the
+// result does not depend on the number of threads. Route may be a
+// std::vector<CheckPoint> or a CheckPointBatch.
+template <typename Route>
+std::vector<std::vector<std::string>>
+generateReports(const std::vector<Route> &routes,
+                const std::vector<ReportBuilderFactory> &factories,
+                unsigned threads = std::thread::hardware_concurrency()) {
+  std::vector<std::vector<std::string>> reports(routes.size());
+  std::atomic<std::size_t> next{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+    while (!failed) {
+      auto r = next.fetch_add(1);
+      if (r >= routes.size()) {
+        return;
+      }
+      try {
+        std::vector<std::unique_ptr<ReportBuilder>> owned;
+        std::vector<ReportBuilder *> builders;
+        for (const auto &factory : factories) {
+          owned.push_back(factory());
+          builders.push_back(owned.back().get());
+        }
+        CompositeReportBuilder composite(builders);
+        composite.addCheckpoints(routes[r]);
+        reports[r] = composite.GetReports();
+      } catch (...) {
+        if (!failed.exchange(true)) {
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+
+  std::size_t count = std::min<std::size_t>(std::max(threads, 1u),
+                                            routes.size());
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < count; ++i) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return reports;
+}
+
+constexpr double kmPerDegree = earthRadiusKm * degToRad;
+
+// Uniform grid over a route's checkpoints in degree space. Cells are at least
+// radiusKm wide wherever the route is, so every checkpoint within radiusKm of
+// a point lies in the 3x3 block of cells around it. Longitude wraps at 180;
+// routes that come within radiusKm of a pole use whole-row cells.
+// The grid points into the route's arrays, so the route must outlive it.
+class CheckPointGrid {
+public:
+  CheckPointGrid(const CheckPointBatch &route, double radiusKm)
+      : latitudes(route.latitude()), longitudes(route.longitude()) {
+    double maxHav = std::sin(radiusKm / earthRadiusKm / 2);
+    maxHaversine = maxHav * maxHav;
+    cellLat = std::max(radiusKm / kmPerDegree, 1e-6);
+
+    float maxAbsLat = 0;
+    for (std::size_t i = 0; i < route.size(); ++i) {
+      maxAbsLat = std::max(maxAbsLat, std::abs(latitudes[i]));
+    }
+    // Two points within radiusKm and at most edgeLat from the equator differ
+    // in longitude by at most 2 asin(sin(radius / 2) / cos(edgeLat)). Once
+    // that reaches 180 degrees the circle can cross the pole, and every row
+    // is scanned whole.
+    double edgeLat = maxAbsLat + cellLat;
+    double spread = edgeLat < 90 ? maxHav / std::cos(edgeLat * degToRad) : 1;
+    if (spread >= 1) {
+      columns = 1;
+    } else {
+      double minCellLon = 2 * std::asin(spread) / degToRad;
+      columns = std::max<std::int64_t>(
+          1, static_cast<std::int64_t>(std::floor(360.0 / minCellLon)));
+    }
+    cellLon = 360.0 / columns;
+
+    cosLatitudes.resize(route.size());
+    std::vector<std::pair<std::int64_t, std::uint32_t>> keyed(route.size());
+    for (std::size_t i = 0; i < route.size(); ++i) {
+      cosLatitudes[i] = std::cos(latitudes[i] * degToRad);
+      keyed[i] = {key(row(latitudes[i]), column(longitudes[i])),
+                  static_cast<std::uint32_t>(i)};
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    indices.reserve(keyed.size());
+    for (std::size_t i = 0; i < keyed.size(); ++i) {
+      if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+        cells[keyed[i].first] = {static_cast<std::uint32_t>(i),
+                                 static_cast<std::uint32_t>(i)};
+      }
+      cells[keyed[i].first].second++;
+      indices.push_back(keyed[i].second);
+    }
+  }
+
+  CheckPointGrid(CheckPointBatch &&route, double radiusKm) = delete;
+
+  // Calls f(index) for every checkpoint within the radius of the point.
+  template <typename F> void forEachNear(float lat, float lon, F &&f) const {
+    double cosLat = std::cos(lat * degToRad);
+    auto r = row(lat);
+    auto c = column(lon);
+    for (auto dr = -1; dr <= 1; ++dr) {
+      if (columns < 3) {
+        for (std::int64_t col = 0; col < columns; ++col) {
+          visitCell(key(r + dr, col), lat, lon, cosLat, f);
+        }
+        continue;
+      }
+      for (auto dc = -1; dc <= 1; ++dc) {
+        visitCell(key(r + dr, (c + dc + columns) % columns), lat, lon, cosLat,
+                  f);
+      }
+    }
+  }
+
+private:
+  const float *latitudes;
+  const float *longitudes;
+  std::vector<double> cosLatitudes;
+  double maxHaversine;
+  double cellLat;
+  double cellLon;
+  std::int64_t columns;
+  std::unordered_map<std::int64_t, std::pair<std::uint32_t, std::uint32_t>>
+      cells;
+  std::vector<std::uint32_t> indices;
+
+  std::int64_t row(float lat) const {
+    return static_cast<std::int64_t>(std::floor((lat + 90.0) / cellLat));
+  }
+  std::int64_t column(float lon) const {
+    auto c = static_cast<std::int64_t>(std::floor((lon + 180.0) / cellLon));
+    return ((c % columns) + columns) % columns;
+  }
+  std::int64_t key(std::int64_t r, std::int64_t c) const {
+    return r * columns + c;
+  }
+
+  template <typename F>
+  void visitCell(std::int64_t cellKey, float lat, float lon, double cosLat,
+                 F &f) const {
+    auto cell = cells.find(cellKey);
+    if (cell == cells.end()) {
+      return;
+    }
+    for (auto i = cell->second.first; i < cell->second.second; ++i) {
+      auto cp = indices[i];
+      double sLat = std::sin((latitudes[cp] - lat) * degToRad / 2);
+      double sLon = std::sin((longitudes[cp] - lon) * degToRad / 2);
+      double a = sLat * sLat + cosLat * cosLatitudes[cp] * sLon * sLon;
+      if (a <= maxHaversine) {
+        f(cp);
+      }
+    }
+  }
+};
+
+// Matches a stream of GPS fixes against a route: a checkpoint is visited
+// once any fix comes within radiusKm of it, in any order. The route must
+// outlive the matcher; reset() reuses the index for the next track.
+class TrackMatcher {
+public:
+  TrackMatcher(const CheckPointBatch &route, double radiusKm)
+      : route(route), grid(route, radiusKm), visitedFlags(route.size(), 0) {};
+
+  TrackMatcher(CheckPointBatch &&route, double radiusKm) = delete;
+
+  void addFix(float lat, float lon) {
+    grid.forEachNear(lat, lon, [this](std::uint32_t i) {
+      visitedCount += visitedFlags[i] ^ 1;
+      visitedFlags[i] = 1;
+    });
+  }
+
+  void addFixes(const float *lat, const float *lon, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      addFix(lat[i], lon[i]);
+    }
+  }
+
+  void reset() {
+    std::fill(visitedFlags.begin(), visitedFlags.end(), 0);
+    visitedCount = 0;
+  }
+
+  bool visited(std::size_t i) const { return visitedFlags[i]; }
+  std::size_t visited() const { return visitedCount; }
+
+  // A missed required checkpoint is a failure of the run.
+  bool failed() const {
+    for (std::size_t i = 0; i < route.size(); ++i) {
+      if (!visitedFlags[i] && route.required()[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  CheckPointBatch missed() const {
+    CheckPointBatch result;
+    for (std::size_t i = 0; i < route.size(); ++i) {
+      if (!visitedFlags[i]) {
+        result.push_back(route.name(i), route.latitude()[i],
+                         route.longitude()[i], route.penalty()[i],
+                         route.required()[i]);
+      }
+    }
+    return result;
+  }
+
+  // Feeds the missed checkpoints to a builder, so PenaltyReportBuilder sums
+  // the penalties of missed optional checkpoints and PrintReportBuilder lists
+  // missed required ones as failures.
+  void reportTo(ReportBuilder &builder) const {
+    builder.addCheckpoints(missed());
+  }
+
+private:
+  const CheckPointBatch &route;
+  CheckPointGrid grid;
+  std::vector<std::uint8_t> visitedFlags;
+  std::size_t visitedCount = 0;
+};
+
+void benchmarkTrackMatching() {
+  constexpr std::size_t checkpoints = 10000;
+  constexpr std::size_t fixes = 5000000;
+  std::mt19937 rng(42);
+  std::normal_distribution<float> step(0, 0.01f);
+
+  CheckPointBatch route;
+  float lat = 55.75f, lon = 37.61f;
+  for (std::size_t i = 0; i < checkpoints; ++i) {
+    lat += step(rng) * 10;
+    lon += step(rng) * 10;
+    route.push_back("cp", lat, lon, 10, i % 10 == 0);
+  }
+
+  std::vector<float> fixLat(fixes), fixLon(fixes);
+  for (std::size_t i = 0; i < fixes; ++i) {
+    auto cp = i * checkpoints / fixes;
+    fixLat[i] = route.latitude()[cp] + step(rng);
+    fixLon[i] = route.longitude()[cp] + step(rng);
+  }
+
+  TrackMatcher matcher(route, 0.5);
+  auto start = std::chrono::steady_clock::now();
+  matcher.addFixes(fixLat.data(), fixLon.data(), fixes);
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  PenaltyReportBuilder penalty;
+  matcher.reportTo(penalty);
+  std::cout << "Track matching: " << fixes << " fixes against " << checkpoints
+            << " checkpoints in " << elapsed.count() << " s, "
+            << fixes / elapsed.count() << " fixes/s\n"
+            << "Visited " << matcher.visited() << ", failed "
+            << (matcher.failed() ? "yes" : "no") << ", penalty "
+            << penalty.GetReport() << "\n";
+}
+
+// Times `repeat` passes of f over a route and returns ns per checkpoint.
+template <typename F>
+double nsPerCheckpoint(std::size_t checkpoints, int repeat, F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (checkpoints * repeat);
+}
+
+// Hides the dynamic type of a builder from the optimizer. Without it the
+// compiler sees a local object of a final class and devirtualizes every call.
+[[gnu::noinline]] ReportBuilder *opaqueBuilder(ReportBuilder *builder) {
+  asm volatile("" : "+r"(builder));
+  return builder;
+}
+
+// Virtual path: the base-class loop calls addCheckpoint through the vtable
+// for every checkpoint. Static path: the loop instantiated for the concrete
+// builder, with add() inlined.
+void benchmarkDispatch() {
+  constexpr std::size_t checkpoints = 1000000;
+  constexpr int repeat = 10;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> coord(-60, 60);
+  std::vector<CheckPoint> route;
+  route.reserve(checkpoints);
+  for (std::size_t i = 0; i < checkpoints; ++i) {
+    if (i % 4 == 0) {
+      route.emplace_back("cp", coord(rng), coord(rng));
+    } else {
+      route.emplace_back("cp", coord(rng), coord(rng), 1.0f);
+    }
+  }
+
+  auto compare = [&](const char *name, auto makeBuilder) {
+    auto virtualBuilder = makeBuilder();
+    ReportBuilder *base = opaqueBuilder(&virtualBuilder);
+    double virtualNs = nsPerCheckpoint(checkpoints, repeat, [&] {
+      base->ReportBuilder::addCheckpoints(route);
+    });
+    auto staticBuilder = makeBuilder();
+    double staticNs = nsPerCheckpoint(checkpoints, repeat, [&] {
+      staticBuilder.addCheckpoints(route);
+    });
+    std::cout << name << ": virtual " << virtualNs << " ns/checkpoint, static "
+              << staticNs << " ns/checkpoint (" << virtualBuilder.GetReport()
+              << " / " << staticBuilder.GetReport() << ")\n";
+  };
+  compare("Penalty", [] { return PenaltyReportBuilder(); });
+  compare("Distance", [] { return DistanceReportBuilder(); });
+}
+
+// Report time for the same routes on 1, 2, 4, ... threads, up to twice the
+// hardware concurrency.
+void benchmarkGenerateReports() {
+  constexpr std::size_t routeCount = 128;
+  constexpr std::size_t checkpoints = 20000;
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> coord(-60, 60);
+  std::vector<CheckPointBatch> routes(routeCount);
+  for (auto &route : routes) {
+    route.reserve(checkpoints);
+    for (std::size_t i = 0; i < checkpoints; ++i) {
+      route.push_back("cp", coord(rng), coord(rng), 1.0f, i % 4 == 0);
+    }
+  }
+  std::vector<ReportBuilderFactory> factories{
+      [] { return std::make_unique<PenaltyReportBuilder>(); },
+      [] { return std::make_unique<DistanceReportBuilder>(); }};
+
+  unsigned maxThreads = 2 * std::max(std::thread::hardware_concurrency(), 1u);
+  double single = 0;
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    auto reports = generateReports(routes, factories, threads);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (threads == 1) {
+      single = elapsed.count();
+    }
+    std::cout << "generateReports: " << routeCount << " routes on " << threads
+              << " threads in " << elapsed.count() << " s, speedup "
+              << single / elapsed.count() << "\n";
+  }
+}
+
+#ifndef CPP4SEM_NO_MAIN
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    benchmarkTrackMatching();
+    benchmarkDispatch();
+    benchmarkGenerateReports();
+    return 0;
+  }
+
   std::vector<CheckPoint> route{CheckPoint("Start", 34.232, 44.543),
                                 CheckPoint("Third", 1.123, 45.124, 100),
                                 CheckPoint("Two thirds", 54.786, 24.133, 300),
                                 CheckPoint("Finish", 20.8, 4.3)};
 
   ReportBuilder *printBuilder = new PrintReportBuilder();
-  printBuilder->addCheckpoints(route);
-  std::cout << "Print Report:\n" << printBuilder->GetReport() << std::endl;
-
   ReportBuilder *penaltyBuilder = new PenaltyReportBuilder();
-  penaltyBuilder->addCheckpoints(route);
+  CompositeReportBuilder bothBuilder({printBuilder, penaltyBuilder});
+  bothBuilder.addCheckpoints(route);
+  std::cout << "Print Report:\n" << printBuilder->GetReport() << std::endl;
   std::cout << "Penalty Report:\n" << penaltyBuilder->GetReport() << std::endl;
 
+  CheckPointBatch batch(route);
+
+  ReportBuilder *batchPenaltyBuilder = new PenaltyReportBuilder();
+  batchPenaltyBuilder->addCheckpoints(batch);
+  std::cout << "Batch Penalty Report:\n"
+            << batchPenaltyBuilder->GetReport() << std::endl;
+
+  PrintReportBuilder batchPrintBuilder;
+  batchPrintBuilder.addCheckpoints(batch);
+  FdSink out(STDOUT_FILENO);
+  std::cout << "Batch Print Report:" << std::endl;
+  batchPrintBuilder.writeReport(out);
+
+  ReportBuilder *distanceBuilder = new DistanceReportBuilder();
+  distanceBuilder->addCheckpoints(batch);
+  std::cout << "Distance Report (km):\n"
+            << distanceBuilder->GetReport() << std::endl;
+
+  std::vector<CheckPointBatch> routes{batch, CheckPointBatch(std::vector{
+                                                 route[1], route[2]})};
+  auto reports = generateReports(
+      routes, {[] { return std::make_unique<PenaltyReportBuilder>(); },
+               [] { return std::make_unique<DistanceReportBuilder>(); }});
+  for (std::size_t r = 0; r < reports.size(); ++r) {
+    std::cout << "Route " << r << ": penalty " << reports[r][0]
+              << ", distance " << reports[r][1] << "\n";
+  }
+
+  TrackMatcher matcher(batch, 1.0);
+  float trackLat[] = {34.2321, 1.1229, 20.8002};
+  float trackLon[] = {44.5432, 45.1238, 4.2999};
+  matcher.addFixes(trackLat, trackLon, 3);
+  PenaltyReportBuilder trackPenalty;
+  matcher.reportTo(trackPenalty);
+  std::cout << "Track: visited " << matcher.visited() << " of " << batch.size()
+            << ", failed " << (matcher.failed() ? "yes" : "no")
+            << ", penalty " << trackPenalty.GetReport() << "\n";
+
   return 0;
 }
+#endif
@@ -1,11 +1,65 @@
 #include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
 #include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+template <typename T, typename = void> struct isHashable : std::false_type {};
+
+template <typename T>
+struct isHashable<
+    T, std::void_t<decltype(std::hash<T>{}(std::declval<const T &>()))>>
+    : std::true_type {};
+
+inline std::uint32_t popcount(std::uint64_t word) {
+  return static_cast<std::uint32_t>(std::bitset<64>(word).count());
+}
+
+inline unsigned lowestBit(std::uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#else
+  unsigned bit = 0;
+  while (!(word >> bit & 1)) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+inline unsigned highestBit(std::uint64_t word) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(word);
+#else
+  unsigned bit = 63;
+  while (!(word >> bit & 1)) {
+    --bit;
+  }
+  return bit;
+#endif
+}
+
 template <typename T> class SetImpl {
 public:
   virtual void add(T element) = 0;
@@ -14,9 +68,20 @@ public:
   virtual std::size_t size() const = 0;
 
   virtual void copyTo(SetImpl<T> *other) const = 0;
-  virtual SetImpl<T> *intersect(SetImpl<T> *other) const = 0;
   virtual std::string getName() const = 0;
 
+  // Bulk transfer used by tier migrations: one virtual call per set instead
+  // of one per element.
+  virtual std::vector<T> toVector() const = 0;
+  // The elements in ascending order if the tier keeps them that way.
+  virtual const std::vector<T> *sortedView() const { return nullptr; }
+  virtual void addAll(std::vector<T> elements) {
+    for (auto &element : elements) {
+      add(std::move(element));
+    }
+  }
+  virtual void reserve(std::size_t) {}
+
   virtual ~SetImpl() {};
 };
 
@@ -24,12 +89,14 @@ template <typename T> class VectorSetImpl : public SetImpl<T> {
 public:
   void add(T element) override {
     if (!contains(element)) {
-      elements.push_back(element);
+      elements.push_back(std::move(element));
     }
   }
   void remove(T element) override {
     auto i = std::find(elements.begin(), elements.end(), element);
-    elements.erase(i);
+    if (i != elements.end()) {
+      elements.erase(i);
+    }
   }
   bool contains(const T &element) const override {
     return std::find(elements.begin(), elements.end(), element) !=
@@ -42,29 +109,46 @@ public:
       other->add(element);
     }
   }
-  SetImpl<T> *intersect(SetImpl<T> *other) const override {
-    auto newSetImpl = new VectorSetImpl<T>();
-    for (auto element : elements) {
-      if (other->contains(element)) {
-        newSetImpl->add(element);
-      }
-    }
-    return newSetImpl;
-  }
 
   std::string getName() const override { return std::string("VectorImpl"); }
 
+  void reserve(std::size_t n) override { elements.reserve(n); }
+
+  std::vector<T> toVector() const override { return elements; }
+
 private:
   std::vector<T> elements;
 };
 
 template <typename T> class TreeSetImpl : public SetImpl<T> {
 public:
-  void add(T element) override { elements.insert(element); }
-  void remove(T element) override {
-    auto i = std::find(elements.begin(), elements.end(), element);
-    elements.erase(i);
+  void add(T element) override { elements.insert(std::move(element)); }
+  void remove(T element) override { elements.erase(element); }
+  bool contains(const T &element) const override {
+    return elements.count(element) != 0;
   }
+  std::size_t size() const override { return elements.size(); }
+
+  void copyTo(SetImpl<T> *other) const override {
+    for (auto element : elements) {
+      other->add(element);
+    }
+  }
+
+  std::string getName() const override { return std::string("TreeImpl"); }
+
+  std::vector<T> toVector() const override {
+    return std::vector<T>(elements.begin(), elements.end());
+  }
+
+private:
+  std::set<T> elements;
+};
+
+template <typename T> class HashSetImpl : public SetImpl<T> {
+public:
+  void add(T element) override { elements.insert(std::move(element)); }
+  void remove(T element) override { elements.erase(element); }
   bool contains(const T &element) const override {
     return elements.count(element) != 0;
   }
@@ -75,76 +159,1176 @@ public:
       other->add(element);
     }
   }
-  SetImpl<T> *intersect(SetImpl<T> *other) const override {
-    auto newSetImpl = new VectorSetImpl<T>();
+
+  std::string getName() const override { return std::string("HashImpl"); }
+
+  void reserve(std::size_t n) override { elements.reserve(n); }
+
+  // One walk over the nodes: the range constructor would walk them twice,
+  // once to count.
+  std::vector<T> toVector() const override {
+    std::vector<T> result;
+    result.reserve(elements.size());
+    for (const auto &element : elements) {
+      result.push_back(element);
+    }
+    return result;
+  }
+  void addAll(std::vector<T> newElements) override {
+    elements.reserve(elements.size() + newElements.size());
+    for (auto &element : newElements) {
+      elements.insert(std::move(element));
+    }
+  }
+
+private:
+  std::unordered_set<T> elements;
+};
+
+// Sorted, duplicate-free std::vector: binary-search lookups over contiguous
+// memory, but O(n) single inserts, so it suits read-mostly sets.
+template <typename T> class SortedVectorSetImpl : public SetImpl<T> {
+public:
+  void add(T element) override {
+    auto i = std::lower_bound(elements.begin(), elements.end(), element);
+    if (i == elements.end() || element < *i) {
+      elements.insert(i, std::move(element));
+    }
+  }
+  void remove(T element) override {
+    auto i = std::lower_bound(elements.begin(), elements.end(), element);
+    if (i != elements.end() && !(element < *i)) {
+      elements.erase(i);
+    }
+  }
+  bool contains(const T &element) const override {
+    return std::binary_search(elements.begin(), elements.end(), element);
+  }
+  std::size_t size() const override { return elements.size(); }
+
+  void copyTo(SetImpl<T> *other) const override {
     for (auto element : elements) {
-      if (!other->contains(element)) {
-        newSetImpl->add(element);
+      other->add(element);
+    }
+  }
+
+  std::string getName() const override {
+    return std::string("SortedVectorImpl");
+  }
+
+  void reserve(std::size_t n) override { elements.reserve(n); }
+
+  std::vector<T> toVector() const override { return elements; }
+  const std::vector<T> *sortedView() const override { return &elements; }
+  void addAll(std::vector<T> newElements) override {
+    if (elements.empty() &&
+        std::is_sorted(newElements.begin(), newElements.end())) {
+      elements = std::move(newElements);
+      elements.erase(std::unique(elements.begin(), elements.end()),
+                     elements.end());
+      return;
+    }
+    auto middle = elements.size();
+    elements.insert(elements.end(),
+                    std::make_move_iterator(newElements.begin()),
+                    std::make_move_iterator(newElements.end()));
+    std::sort(elements.begin() + middle, elements.end());
+    std::inplace_merge(elements.begin(), elements.begin() + middle,
+                       elements.end());
+    elements.erase(std::unique(elements.begin(), elements.end()),
+                   elements.end());
+  }
+
+private:
+  std::vector<T> elements;
+};
+
+template <typename T>
+struct isBitmapKey
+    : std::bool_constant<std::is_integral_v<T> && !std::is_same_v<T, bool>> {
+};
+
+enum BitmapOp { BITMAP_AND, BITMAP_OR, BITMAP_ANDNOT, BITMAP_XOR };
+
+// Roaring-style compressed bitmap for integral keys. A key is split into a
+// high part, which selects a container, and a 16-bit low part stored in it.
+// Containers are sorted arrays of lows (up to 4096 values), 2^16-bit bitmaps,
+// or runs of consecutive lows, whichever is smallest. Keys are stored with
+// the sign bit flipped so that container order is the order of T.
+template <typename T> class BitmapSetImpl : public SetImpl<T> {
+public:
+  using Key = std::make_unsigned_t<T>;
+
+  static Key encode(T element) {
+    auto key = static_cast<Key>(element);
+    if constexpr (std::is_signed_v<T>) {
+      key ^= static_cast<Key>(Key(1) << (sizeof(T) * 8 - 1));
+    }
+    return key;
+  }
+  static T decode(Key key) {
+    if constexpr (std::is_signed_v<T>) {
+      key ^= static_cast<Key>(Key(1) << (sizeof(T) * 8 - 1));
+    }
+    return static_cast<T>(key);
+  }
+
+  void add(T element) override {
+    auto key = encode(element);
+    auto i = std::lower_bound(highs.begin(), highs.end(), high(key)) -
+             highs.begin();
+    if (i == static_cast<std::ptrdiff_t>(highs.size()) ||
+        highs[i] != high(key)) {
+      highs.insert(highs.begin() + i, high(key));
+      containers.insert(containers.begin() + i, Container());
+    }
+    count += containers[i].add(low(key));
+  }
+  void remove(T element) override {
+    auto key = encode(element);
+    auto i = find(high(key));
+    if (i == highs.size()) {
+      return;
+    }
+    count -= containers[i].remove(low(key));
+    if (containers[i].cardinality == 0) {
+      highs.erase(highs.begin() + i);
+      containers.erase(containers.begin() + i);
+    }
+  }
+  bool contains(const T &element) const override {
+    auto key = encode(element);
+    auto i = find(high(key));
+    return i != highs.size() && containers[i].contains(low(key));
+  }
+  std::size_t size() const override { return count; }
+
+  void copyTo(SetImpl<T> *other) const override {
+    forEach([other](T element) { other->add(element); });
+  }
+
+  std::string getName() const override { return std::string("BitmapImpl"); }
+
+  // Ascending order, like the sorted tiers.
+  std::vector<T> toVector() const override {
+    std::vector<T> elements;
+    elements.reserve(count);
+    forEach([&elements](T element) { elements.push_back(element); });
+    return elements;
+  }
+
+  // Bulk load: one sort, then every container is built directly from its
+  // slice of the sorted keys. A non-empty bitmap is OR-ed with the result.
+  void addAll(std::vector<T> elements) override {
+    if (count != 0) {
+      BitmapSetImpl<T> added;
+      added.addAll(std::move(elements));
+      std::unique_ptr<BitmapSetImpl<T>> merged(combine(added, BITMAP_OR));
+      highs.swap(merged->highs);
+      containers.swap(merged->containers);
+      count = merged->count;
+      return;
+    }
+    if (!std::is_sorted(elements.begin(), elements.end())) {
+      std::sort(elements.begin(), elements.end());
+    }
+    elements.erase(std::unique(elements.begin(), elements.end()),
+                   elements.end());
+    for (std::size_t first = 0; first < elements.size();) {
+      auto h = high(encode(elements[first]));
+      auto last = first;
+      Container container;
+      while (last < elements.size() && high(encode(elements[last])) == h) {
+        container.values.push_back(low(encode(elements[last])));
+        ++last;
+      }
+      container.cardinality = static_cast<std::uint32_t>(last - first);
+      if (container.cardinality > Container::arrayMax) {
+        container.toBitmap();
       }
+      container.optimize();
+      highs.push_back(h);
+      containers.push_back(std::move(container));
+      first = last;
     }
-    return newSetImpl;
+    count = elements.size();
   }
 
-  std::string getName() const override { return std::string("TreeImpl"); }
+  T minimum() const {
+    return decode(static_cast<Key>(key(0, containers.front().first())));
+  }
+  T maximum() const {
+    return decode(
+        static_cast<Key>(key(highs.size() - 1, containers.back().last())));
+  }
+
+  // Container-wise set operation; containers with matching high parts are
+  // combined with word-wise bitwise kernels.
+  BitmapSetImpl<T> *combine(const BitmapSetImpl<T> &other, BitmapOp op) const {
+    auto result = new BitmapSetImpl<T>();
+    std::size_t i = 0, j = 0;
+    auto keep = [result](std::uint64_t h, Container container) {
+      if (container.cardinality != 0) {
+        result->count += container.cardinality;
+        result->highs.push_back(h);
+        result->containers.push_back(std::move(container));
+      }
+    };
+    while (i < highs.size() || j < other.highs.size()) {
+      if (j == other.highs.size() ||
+          (i < highs.size() && highs[i] < other.highs[j])) {
+        if (op != BITMAP_AND) {
+          keep(highs[i], containers[i]);
+        }
+        ++i;
+      } else if (i == highs.size() || other.highs[j] < highs[i]) {
+        if (op == BITMAP_OR || op == BITMAP_XOR) {
+          keep(other.highs[j], other.containers[j]);
+        }
+        ++j;
+      } else {
+        keep(highs[i], Container::combine(containers[i], other.containers[j],
+                                          op));
+        ++i;
+        ++j;
+      }
+    }
+    return result;
+  }
 
 private:
-  std::set<T> elements;
+  struct Container {
+    enum Kind { ARRAY, BITMAP, RUN };
+    static constexpr std::uint32_t arrayMax = 4096;
+    static constexpr std::size_t wordCount = 1024;
+
+    Kind kind = ARRAY;
+    std::uint32_t cardinality = 0;
+    // ARRAY: sorted lows. RUN: flattened (first, last) pairs.
+    std::vector<std::uint16_t> values;
+    // BITMAP: 2^16 bits.
+    std::vector<std::uint64_t> words;
+
+    bool contains(std::uint16_t x) const {
+      switch (kind) {
+      case ARRAY:
+        return std::binary_search(values.begin(), values.end(), x);
+      case BITMAP:
+        return words[x >> 6] >> (x & 63) & 1;
+      default: {
+        std::size_t lo = 0, hi = values.size() / 2;
+        while (lo < hi) {
+          auto mid = (lo + hi) / 2;
+          if (values[2 * mid + 1] < x) {
+            lo = mid + 1;
+          } else {
+            hi = mid;
+          }
+        }
+        return lo < values.size() / 2 && values[2 * lo] <= x;
+      }
+      }
+    }
+
+    bool add(std::uint16_t x) {
+      if (kind == RUN) {
+        unpackRuns();
+      }
+      if (kind == ARRAY) {
+        auto i = std::lower_bound(values.begin(), values.end(), x);
+        if (i != values.end() && *i == x) {
+          return false;
+        }
+        values.insert(i, x);
+        if (++cardinality > arrayMax) {
+          toBitmap();
+        }
+        return true;
+      }
+      auto &word = words[x >> 6];
+      auto bit = std::uint64_t(1) << (x & 63);
+      if (word & bit) {
+        return false;
+      }
+      word |= bit;
+      ++cardinality;
+      return true;
+    }
+
+    // Bitmaps fall back to arrays at half the array limit, so removing and
+    // re-adding around 4096 values does not convert on every call.
+    bool remove(std::uint16_t x) {
+      if (kind == RUN) {
+        unpackRuns();
+      }
+      if (kind == ARRAY) {
+        auto i = std::lower_bound(values.begin(), values.end(), x);
+        if (i == values.end() || *i != x) {
+          return false;
+        }
+        values.erase(i);
+        --cardinality;
+        return true;
+      }
+      auto &word = words[x >> 6];
+      auto bit = std::uint64_t(1) << (x & 63);
+      if (!(word & bit)) {
+        return false;
+      }
+      word &= ~bit;
+      if (--cardinality < arrayMax / 2) {
+        toArray();
+      }
+      return true;
+    }
+
+    template <typename F> void forEach(F &&f) const {
+      switch (kind) {
+      case ARRAY:
+        for (auto x : values) {
+          f(x);
+        }
+        break;
+      case BITMAP:
+        for (std::size_t w = 0; w < wordCount; ++w) {
+          for (auto word = words[w]; word != 0; word &= word - 1) {
+            f(static_cast<std::uint16_t>(w * 64 + lowestBit(word)));
+          }
+        }
+        break;
+      default:
+        for (std::size_t r = 0; r < values.size(); r += 2) {
+          for (std::uint32_t x = values[r]; x <= values[r + 1]; ++x) {
+            f(static_cast<std::uint16_t>(x));
+          }
+        }
+      }
+    }
+
+    std::uint16_t first() const {
+      if (kind == BITMAP) {
+        std::size_t w = 0;
+        while (words[w] == 0) {
+          ++w;
+        }
+        return static_cast<std::uint16_t>(w * 64 + lowestBit(words[w]));
+      }
+      return values.front();
+    }
+    std::uint16_t last() const {
+      if (kind == BITMAP) {
+        std::size_t w = wordCount - 1;
+        while (words[w] == 0) {
+          --w;
+        }
+        return static_cast<std::uint16_t>(w * 64 + highestBit(words[w]));
+      }
+      return values.back();
+    }
+
+    void fillWords(std::uint64_t *out) const {
+      if (kind == BITMAP) {
+        std::copy(words.begin(), words.end(), out);
+        return;
+      }
+      std::fill(out, out + wordCount, 0);
+      forEach([out](std::uint16_t x) {
+        out[x >> 6] |= std::uint64_t(1) << (x & 63);
+      });
+    }
+
+    void toBitmap() {
+      words.assign(wordCount, 0);
+      fillWords(words.data());
+      kind = BITMAP;
+      values.clear();
+      values.shrink_to_fit();
+    }
+
+    void toArray() {
+      std::vector<std::uint16_t> lows;
+      lows.reserve(cardinality);
+      forEach([&lows](std::uint16_t x) { lows.push_back(x); });
+      values.swap(lows);
+      kind = ARRAY;
+      words.clear();
+      words.shrink_to_fit();
+    }
+
+    void unpackRuns() {
+      if (cardinality > arrayMax) {
+        toBitmap();
+      } else {
+        toArray();
+      }
+    }
+
+    // Re-encodes as runs when that is smaller than both an array (2 bytes
+    // per value) and a bitmap (8 KiB).
+    void optimize() {
+      std::size_t runs = 0;
+      std::int32_t previous = -2;
+      forEach([&](std::uint16_t x) {
+        runs += x != previous + 1;
+        previous = x;
+      });
+      if (4 * runs >= std::min<std::size_t>(2 * cardinality, 8 * wordCount)) {
+        return;
+      }
+      std::vector<std::uint16_t> pairs;
+      pairs.reserve(2 * runs);
+      previous = -2;
+      forEach([&](std::uint16_t x) {
+        if (x != previous + 1) {
+          pairs.push_back(x);
+          pairs.push_back(x);
+        } else {
+          pairs.back() = x;
+        }
+        previous = x;
+      });
+      values.swap(pairs);
+      kind = RUN;
+      words.clear();
+      words.shrink_to_fit();
+    }
+
+    static Container combine(const Container &a, const Container &b,
+                             BitmapOp op) {
+      Container result;
+      if (a.kind == ARRAY && b.kind == ARRAY) {
+        auto out = std::back_inserter(result.values);
+        auto a0 = a.values.begin(), a1 = a.values.end();
+        auto b0 = b.values.begin(), b1 = b.values.end();
+        switch (op) {
+        case BITMAP_AND:
+          std::set_intersection(a0, a1, b0, b1, out);
+          break;
+        case BITMAP_OR:
+          std::set_union(a0, a1, b0, b1, out);
+          break;
+        case BITMAP_ANDNOT:
+          std::set_difference(a0, a1, b0, b1, out);
+          break;
+        case BITMAP_XOR:
+          std::set_symmetric_difference(a0, a1, b0, b1, out);
+          break;
+        }
+        result.cardinality = static_cast<std::uint32_t>(result.values.size());
+        if (result.cardinality > arrayMax) {
+          result.toBitmap();
+        }
+        return result;
+      }
+      if (op == BITMAP_AND && (a.kind == ARRAY || b.kind == ARRAY)) {
+        const auto &array = a.kind == ARRAY ? a : b;
+        const auto &other = a.kind == ARRAY ? b : a;
+        for (auto x : array.values) {
+          if (other.contains(x)) {
+            result.values.push_back(x);
+          }
+        }
+        result.cardinality = static_cast<std::uint32_t>(result.values.size());
+        return result;
+      }
+
+      std::uint64_t wa[wordCount], wb[wordCount];
+      a.fillWords(wa);
+      b.fillWords(wb);
+      result.words.resize(wordCount);
+      auto *out = result.words.data();
+      switch (op) {
+      case BITMAP_AND:
+        for (std::size_t w = 0; w < wordCount; ++w) {
+          out[w] = wa[w] & wb[w];
+        }
+        break;
+      case BITMAP_OR:
+        for (std::size_t w = 0; w < wordCount; ++w) {
+          out[w] = wa[w] | wb[w];
+        }
+        break;
+      case BITMAP_ANDNOT:
+        for (std::size_t w = 0; w < wordCount; ++w) {
+          out[w] = wa[w] & ~wb[w];
+        }
+        break;
+      case BITMAP_XOR:
+        for (std::size_t w = 0; w < wordCount; ++w) {
+          out[w] = wa[w] ^ wb[w];
+        }
+        break;
+      }
+      std::uint32_t cardinality = 0;
+      for (std::size_t w = 0; w < wordCount; ++w) {
+        cardinality += popcount(out[w]);
+      }
+      result.kind = BITMAP;
+      result.cardinality = cardinality;
+      if (cardinality <= arrayMax) {
+        result.toArray();
+      }
+      return result;
+    }
+  };
+
+  std::vector<std::uint64_t> highs;
+  std::vector<Container> containers;
+  std::size_t count = 0;
+
+  static std::uint64_t high(Key key) {
+    return static_cast<std::uint64_t>(key) >> 16;
+  }
+  static std::uint16_t low(Key key) {
+    return static_cast<std::uint16_t>(key & 0xFFFF);
+  }
+  std::uint64_t key(std::size_t container, std::uint16_t x) const {
+    return highs[container] << 16 | x;
+  }
+
+  std::size_t find(std::uint64_t h) const {
+    auto i = std::lower_bound(highs.begin(), highs.end(), h);
+    if (i == highs.end() || *i != h) {
+      return highs.size();
+    }
+    return i - highs.begin();
+  }
+
+  template <typename F> void forEach(F &&f) const {
+    for (std::size_t i = 0; i < highs.size(); ++i) {
+      containers[i].forEach(
+          [&](std::uint16_t x) { f(decode(static_cast<Key>(key(i, x)))); });
+    }
+  }
+};
+
+// Kernels over sorted, duplicate-free arrays. Results are appended to `out`
+// in ascending order.
+namespace SetOps {
+// Size ratio above which merging is replaced by searching the larger input.
+constexpr std::size_t gallopRatio = 32;
+
+// First index in [from, n) whose element is not less than x, found by
+// doubling the step from `from` and then binary searching the last step.
+template <typename T>
+std::size_t gallop(const T *a, std::size_t from, std::size_t n, const T &x) {
+  std::size_t step = 1;
+  std::size_t hi = from;
+  while (hi < n && a[hi] < x) {
+    from = hi + 1;
+    hi += step;
+    step *= 2;
+  }
+  return std::lower_bound(a + from, a + std::min(hi, n), x) - a;
+}
+
+template <typename T>
+void intersectMerge(const T *a, std::size_t na, const T *b, std::size_t nb,
+                    std::vector<T> &out) {
+  std::size_t i = 0, j = 0;
+#if defined(__SSE2__)
+  // 4x4 all-pairs comparison of 32-bit keys: b is rotated three times so
+  // every lane of a meets every lane of b, and the block with the smaller
+  // maximum is consumed.
+  if constexpr (std::is_integral_v<T> && sizeof(T) == 4) {
+    while (i + 4 <= na && j + 4 <= nb) {
+      __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+      __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+      __m128i eq = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                       _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+          _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4e)),
+                       _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+      int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+      for (int k = 0; k < 4; ++k) {
+        if (mask >> k & 1) {
+          out.push_back(a[i + k]);
+        }
+      }
+      T aMax = a[i + 3];
+      T bMax = b[j + 3];
+      if (!(bMax < aMax)) {
+        i += 4;
+      }
+      if (!(aMax < bMax)) {
+        j += 4;
+      }
+    }
+  }
+#endif
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      ++i;
+    } else if (b[j] < a[i]) {
+      ++j;
+    } else {
+      out.push_back(a[i]);
+      ++i;
+      ++j;
+    }
+  }
+}
+
+// Intersection of a small array with a much larger one.
+template <typename T>
+void intersectGallop(const T *small, std::size_t ns, const T *large,
+                     std::size_t nl, std::vector<T> &out) {
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < ns && j < nl; ++i) {
+    j = gallop(large, j, nl, small[i]);
+    if (j < nl && !(small[i] < large[j])) {
+      out.push_back(small[i]);
+    }
+  }
+}
+
+template <typename T>
+void intersect(const T *a, std::size_t na, const T *b, std::size_t nb,
+               std::vector<T> &out) {
+  if (na * gallopRatio < nb) {
+    intersectGallop(a, na, b, nb, out);
+  } else if (nb * gallopRatio < na) {
+    intersectGallop(b, nb, a, na, out);
+  } else {
+    intersectMerge(a, na, b, nb, out);
+  }
+}
+
+// Elements of a that are not in b.
+template <typename T>
+void difference(const T *a, std::size_t na, const T *b, std::size_t nb,
+                std::vector<T> &out) {
+  if (na * gallopRatio < nb) {
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < na; ++i) {
+      j = gallop(b, j, nb, a[i]);
+      if (j == nb || a[i] < b[j]) {
+        out.push_back(a[i]);
+      }
+    }
+    return;
+  }
+  std::set_difference(a, a + na, b, b + nb, std::back_inserter(out));
+}
+
+template <typename T>
+void unite(const T *a, std::size_t na, const T *b, std::size_t nb,
+           std::vector<T> &out) {
+  std::set_union(a, a + na, b, b + nb, std::back_inserter(out));
+}
+
+template <typename T>
+void symmetricDifference(const T *a, std::size_t na, const T *b,
+                         std::size_t nb, std::vector<T> &out) {
+  std::set_symmetric_difference(a, a + na, b, b + nb,
+                                std::back_inserter(out));
+}
+} // namespace SetOps
+
+enum SetTier {
+  TIER_VECTOR,
+  TIER_SORTED_VECTOR,
+  TIER_HASH,
+  TIER_TREE,
+  TIER_BITMAP
+};
+
+// When a Set changes implementation. Sizes above growThreshold leave the
+// small vector tier, sizes below shrinkThreshold return to it; the gap between
+// the two keeps sets that hover around one size from migrating back and
+// forth. While large, the tier is re-chosen every retierInterval operations:
+// lookup-heavy sets (lookups >= lookupHeavyRatio * writes, where writes are
+// adds, removes and bulk inserts) move to the sorted vector, others to the
+// hash (or tree for unhashable types). Leaving the sorted vector needs a
+// ratio four times lower than entering it. A write to the sorted vector
+// shifts O(n) elements, so once writes * size within the interval reaches
+// sortedShiftBudget the set leaves it without waiting for the interval to
+// end. Both the current interval and a running average over past ones are
+// checked against the budget, and entering the sorted vector needs a quarter
+// of it, so write rates near the budget do not bounce between the two tiers.
+// Integral keys that are dense (on average at least four per 2^16-wide range
+// they span) use the compressed bitmap tier, and leave it once that drops
+// below one.
+struct SetPolicy {
+  std::size_t growThreshold = 32;
+  std::size_t shrinkThreshold = 8;
+  std::size_t lookupHeavyRatio = 16;
+  std::size_t retierInterval = 4096;
+  std::size_t sortedShiftBudget = std::size_t(1) << 24;
+};
+
+// Statistics counter bumped from const lookups. Several threads may read a
+// Set at once, so the counter is atomic, but it uses a relaxed load and store
+// instead of a read-modify-write: concurrent bumps may be lost, which only
+// makes the statistics approximate, and single-threaded lookups pay nothing.
+class LookupCounter {
+public:
+  LookupCounter() = default;
+  LookupCounter(LookupCounter &&other) : value(other.get()) {};
+  LookupCounter &operator=(LookupCounter &&other) {
+    value.store(other.get(), std::memory_order_relaxed);
+    return *this;
+  }
+
+  void bump() { value.store(get() + 1, std::memory_order_relaxed); }
+  void reset() { value.store(0, std::memory_order_relaxed); }
+  std::size_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<std::size_t> value{0};
 };
 
 template <typename T> class Set {
 public:
-  void add(T element) {
-    impl->add(element);
-    checkResize(1);
+  Set(SetPolicy policy = SetPolicy()) : policy(policy) {};
+
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  Set(InputIt first, InputIt last, SetPolicy policy = SetPolicy())
+      : policy(policy) {
+    insertRange(first, last);
+  }
+
+  Set(std::initializer_list<T> elements, SetPolicy policy = SetPolicy())
+      : policy(policy) {
+    insertRange(elements.begin(), elements.end());
+  }
+
+  void add(const T &element) { add(T(element)); }
+  void add(T &&element) {
+    if constexpr (isBitmapKey<T>::value) {
+      extendRange(element, element);
+    }
+    impl->add(std::move(element));
+    ++writes;
+    rebalance();
+  }
+  template <typename... Args> void emplace(Args &&...args) {
+    add(T(std::forward<Args>(args)...));
+  }
+
+  // Bulk insert: the elements are sorted and deduplicated once, the tier for
+  // the final size is chosen before loading, and the data moves into it with
+  // a single addAll() call.
+  template <typename InputIt> void insertRange(InputIt first, InputIt last) {
+    std::vector<T> elements(first, last);
+    std::sort(elements.begin(), elements.end());
+    elements.erase(std::unique(elements.begin(), elements.end()),
+                   elements.end());
+    if (elements.empty()) {
+      return;
+    }
+    if constexpr (isBitmapKey<T>::value) {
+      extendRange(elements.front(), elements.back());
+    }
+    // One merge into the sorted tier shifts the array once, like one write.
+    ++writes;
+    prepare(size() + elements.size());
+    impl->addAll(std::move(elements));
+    rebalance();
+  }
+
+  // Moves the set to the tier chosen for n elements now and keeps it out of
+  // the small tier from then on.
+  void reserve(std::size_t n) {
+    reserved = std::max(reserved, n);
+    prepare(n);
+    impl->reserve(n);
   }
   void remove(T element) {
     impl->remove(element);
-    checkResize(-1);
+    ++writes;
+    rebalance();
+  }
+  bool contains(const T &element) const {
+    lookups.bump();
+    return impl->contains(element);
   }
-  bool contains(const T &element) const { return impl->contains(element); }
   std::size_t size() const { return impl->size(); }
 
   std::string getName() { return impl->getName(); }
+  SetTier getTier() const { return tier; }
+  std::size_t getMigrations() const { return migrations; }
 
-  Set<T> merge(const Set<T> &other) {
-    Set<T> newSet{};
-    auto newSize = size() + other.size();
-    newSet.checkResize(newSize);
+  Set<T> merge(const Set<T> &other) const { return unite(other); }
 
-    impl->copyTo(newSet.impl.get());
-    other.impl->copyTo(newSet.impl.get());
-    return newSet;
+  // Set algebra works on sorted element arrays (borrowed from the sorted
+  // tier, copied and sorted otherwise). Where one side is a hash tier the
+  // other side is walked and probed into it instead, and only the result is
+  // sorted. Results use this set's policy.
+  Set<T> intersect(const Set<T> &other) const {
+    if (auto bitmap = combineBitmaps(other, BITMAP_AND)) {
+      return std::move(*bitmap);
+    }
+    // Probe the hash with the smaller side when both are hashed; a hash much
+    // smaller than the other side is cheaper to sort and gallop.
+    bool probeThis = hashed() && (!other.hashed() || other.size() <= size());
+    bool probeOther = !probeThis && other.hashed();
+    if (probeThis && other.size() <= size() * SetOps::gallopRatio) {
+      return probeHash(other, *this, true);
+    }
+    if (probeOther && size() <= other.size() * SetOps::gallopRatio) {
+      return probeHash(*this, other, true);
+    }
+    return combine(other, SetOps::intersect<T>);
   }
-  Set<T> intersect(const Set<T> &other) {
-    Set<T> newSet{};
-    newSet.impl.reset(impl->intersect(other.impl.get()));
-    return newSet;
+  Set<T> unite(const Set<T> &other) const {
+    if (auto bitmap = combineBitmaps(other, BITMAP_OR)) {
+      return std::move(*bitmap);
+    }
+    return combine(other, SetOps::unite<T>);
+  }
+  Set<T> difference(const Set<T> &other) const {
+    if (auto bitmap = combineBitmaps(other, BITMAP_ANDNOT)) {
+      return std::move(*bitmap);
+    }
+    if (other.hashed()) {
+      return probeHash(*this, other, false);
+    }
+    return combine(other, SetOps::difference<T>);
+  }
+  Set<T> symmetricDifference(const Set<T> &other) const {
+    if (auto bitmap = combineBitmaps(other, BITMAP_XOR)) {
+      return std::move(*bitmap);
+    }
+    return combine(other, SetOps::symmetricDifference<T>);
   }
 
 private:
-  static std::size_t maxSize;
+  SetPolicy policy;
+  SetTier tier = TIER_VECTOR;
   std::unique_ptr<SetImpl<T>> impl{new VectorSetImpl<T>()};
+  mutable LookupCounter lookups;
+  std::size_t writes = 0;
+  // Writes per interval, halved at every interval end.
+  std::size_t writeHistory = 0;
+  std::size_t migrations = 0;
+  // Smallest and largest integral key added so far (an over-estimate of the
+  // span after removals), used to judge density.
+  std::optional<T> rangeMin, rangeMax;
+  std::size_t reserved = 0;
 
-  void checkResize(int delta) {
-    auto s = size();
-    if (delta > 0 && s != maxSize + 1 || delta < 0 && s != maxSize) {
+  static std::unique_ptr<SetImpl<T>> makeImpl(SetTier tier) {
+    switch (tier) {
+    case TIER_SORTED_VECTOR:
+      return std::make_unique<SortedVectorSetImpl<T>>();
+    case TIER_HASH:
+      if constexpr (isHashable<T>::value) {
+        return std::make_unique<HashSetImpl<T>>();
+      }
+      [[fallthrough]];
+    case TIER_TREE:
+      return std::make_unique<TreeSetImpl<T>>();
+    case TIER_BITMAP:
+      if constexpr (isBitmapKey<T>::value) {
+        return std::make_unique<BitmapSetImpl<T>>();
+      }
+      [[fallthrough]];
+    default:
+      return std::make_unique<VectorSetImpl<T>>();
+    }
+  }
+
+  void extendRange(const T &low, const T &high) {
+    if (!rangeMin || low < *rangeMin) {
+      rangeMin = low;
+    }
+    if (!rangeMax || *rangeMax < high) {
+      rangeMax = high;
+    }
+  }
+
+  // Whether n keys would give at least perChunk keys per 2^16-wide chunk of
+  // the key span.
+  bool dense(std::size_t perChunk, std::size_t n) const {
+    if constexpr (isBitmapKey<T>::value) {
+      if (!rangeMin) {
+        return false;
+      }
+      using Bitmap = BitmapSetImpl<T>;
+      std::uint64_t span =
+          Bitmap::encode(*rangeMax) - Bitmap::encode(*rangeMin);
+      return ((span >> 16) + 1) * perChunk <= n;
+    }
+    return false;
+  }
+
+  // Large tier for a set that is about to hold n elements.
+  SetTier chooseLargeTier(std::size_t n) const {
+    if (dense(tier == TIER_BITMAP ? 1 : 4, n)) {
+      return TIER_BITMAP;
+    }
+    auto ratio = policy.lookupHeavyRatio;
+    auto budget = policy.sortedShiftBudget / 4;
+    if (tier == TIER_SORTED_VECTOR) {
+      ratio = std::max<std::size_t>(ratio / 4, 1);
+      budget = policy.sortedShiftBudget;
+    }
+    if (lookups.get() >= ratio * std::max<std::size_t>(writes, 1) &&
+        std::max(writes, writeHistory) * n < budget) {
+      return TIER_SORTED_VECTOR;
+    }
+    return isHashable<T>::value ? TIER_HASH : TIER_TREE;
+  }
+
+  // Elements in ascending order; scratch holds them unless the tier already
+  // keeps a sorted array.
+  const std::vector<T> &sorted(std::vector<T> &scratch) const {
+    if (auto view = impl->sortedView()) {
+      return *view;
+    }
+    scratch = impl->toVector();
+    if (tier != TIER_TREE && tier != TIER_BITMAP) {
+      std::sort(scratch.begin(), scratch.end());
+    }
+    return scratch;
+  }
+
+  Set<T> fromSorted(std::vector<T> elements) const {
+    Set<T> newSet{policy};
+    if (isBitmapKey<T>::value && !elements.empty()) {
+      newSet.extendRange(elements.front(), elements.back());
+    }
+    if (elements.size() > policy.growThreshold) {
+      newSet.tier = newSet.dense(4, elements.size()) ? TIER_BITMAP
+                                                     : TIER_SORTED_VECTOR;
+      newSet.impl = makeImpl(newSet.tier);
+    }
+    newSet.impl->addAll(std::move(elements));
+    return newSet;
+  }
+
+  template <typename Kernel>
+  Set<T> combine(const Set<T> &other, Kernel kernel) const {
+    std::vector<T> scratchA, scratchB, out;
+    const auto &a = sorted(scratchA);
+    const auto &b = other.sorted(scratchB);
+    kernel(a.data(), a.size(), b.data(), b.size(), out);
+    return fromSorted(std::move(out));
+  }
+
+  std::optional<Set<T>> combineBitmaps(const Set<T> &other,
+                                       BitmapOp op) const {
+    if constexpr (isBitmapKey<T>::value) {
+      if (tier == TIER_BITMAP && other.tier == TIER_BITMAP) {
+        using Bitmap = BitmapSetImpl<T>;
+        Set<T> newSet{policy};
+        newSet.impl.reset(static_cast<const Bitmap &>(*impl).combine(
+            static_cast<const Bitmap &>(*other.impl), op));
+        newSet.tier = TIER_BITMAP;
+        if (newSet.size() != 0) {
+          auto &bitmap = static_cast<const Bitmap &>(*newSet.impl);
+          newSet.extendRange(bitmap.minimum(), bitmap.maximum());
+        }
+        newSet.rebalance();
+        return newSet;
+      }
+    }
+    return std::nullopt;
+  }
+
+  bool hashed() const { return isHashable<T>::value && tier == TIER_HASH; }
+
+  // Keeps the elements of walked that are (keep == true) or are not
+  // (keep == false) in the hash tier of probed. walked is read in storage
+  // order and only the result is sorted.
+  Set<T> probeHash(const Set<T> &walked, const Set<T> &probed,
+                   bool keep) const {
+    std::vector<T> out;
+    if constexpr (isHashable<T>::value) {
+      const auto &hash = static_cast<const HashSetImpl<T> &>(*probed.impl);
+      auto probe = [&](const std::vector<T> &elements) {
+        for (const auto &element : elements) {
+          if (hash.HashSetImpl<T>::contains(element) == keep) {
+            out.push_back(element);
+          }
+        }
+      };
+      if (auto view = walked.impl->sortedView()) {
+        probe(*view);
+      } else {
+        probe(walked.impl->toVector());
+        if (walked.tier != TIER_TREE && walked.tier != TIER_BITMAP) {
+          std::sort(out.begin(), out.end());
+        }
+      }
+    }
+    return fromSorted(std::move(out));
+  }
+
+  void migrate(SetTier newTier) {
+    auto newImpl = makeImpl(newTier);
+    auto elements = impl->toVector();
+    if constexpr (isBitmapKey<T>::value) {
+      rangeMin.reset();
+      rangeMax.reset();
+      if (!elements.empty()) {
+        auto [low, high] =
+            std::minmax_element(elements.begin(), elements.end());
+        extendRange(*low, *high);
+      }
+    }
+    newImpl->addAll(std::move(elements));
+    impl = std::move(newImpl);
+    tier = newTier;
+    ++migrations;
+  }
+
+  // Leaves the small tier ahead of growing to n elements. An empty set just
+  // swaps its implementation, which is not counted as a migration.
+  void prepare(std::size_t n) {
+    if (tier != TIER_VECTOR || n <= policy.growThreshold) {
       return;
     }
-    std::unique_ptr<SetImpl<T>> newImpl;
-    if (delta > 0) {
-      newImpl = std::make_unique<TreeSetImpl<T>>();
-    } else if (delta < 0) {
-      newImpl = std::make_unique<VectorSetImpl<T>>();
+    auto newTier = chooseLargeTier(n);
+    if (size() == 0) {
+      impl = makeImpl(newTier);
+      tier = newTier;
+    } else {
+      migrate(newTier);
+    }
+  }
+
+  void rebalance() {
+    auto s = std::max(size(), reserved);
+    if (tier == TIER_VECTOR) {
+      if (s > policy.growThreshold) {
+        migrate(chooseLargeTier(s));
+      }
+    } else if (s < policy.shrinkThreshold) {
+      migrate(TIER_VECTOR);
+    } else if (lookups.get() + writes >= policy.retierInterval ||
+               (tier == TIER_SORTED_VECTOR &&
+                writes * s >= policy.sortedShiftBudget)) {
+      auto newTier = chooseLargeTier(s);
+      if (newTier != tier) {
+        migrate(newTier);
+      }
+      writeHistory = (writeHistory + writes) / 2;
+      lookups.reset();
+      writes = 0;
+    }
+  }
+};
+
+// Set shared between threads. Elements are spread over independently locked
+// hash stripes: contains() takes a shared lock on one stripe, add() and
+// remove() an exclusive one, and a stripe rehashes (grows) only under its
+// exclusive lock, so readers never see a table in the middle of a resize.
+template <typename T> class ConcurrentSet {
+  static_assert(isHashable<T>::value, "ConcurrentSet needs std::hash<T>");
+
+public:
+  ConcurrentSet(std::size_t stripeCount = 64)
+      : stripes(roundUp(stripeCount)), mask(roundUp(stripeCount) - 1) {};
+
+  void add(const T &element) { add(T(element)); }
+  void add(T &&element) {
+    auto &stripe = stripeFor(element);
+    std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+    if (stripe.elements.insert(std::move(element)).second) {
+      count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  void remove(const T &element) {
+    auto &stripe = stripeFor(element);
+    std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+    if (stripe.elements.erase(element) != 0) {
+      count.fetch_sub(1, std::memory_order_relaxed);
     }
-    impl->copyTo(newImpl.get());
-    impl.reset(newImpl.release());
+  }
+  bool contains(const T &element) const {
+    auto &stripe = stripeFor(element);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    return stripe.elements.count(element) != 0;
+  }
+  // Exact when no writer is running, otherwise a recent value.
+  std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+private:
+  struct alignas(64) Stripe {
+    mutable std::shared_mutex mutex;
+    std::unordered_set<T> elements;
+  };
+
+  std::vector<Stripe> stripes;
+  std::size_t mask;
+  std::atomic<std::size_t> count{0};
+
+  static std::size_t roundUp(std::size_t n) {
+    std::size_t power = 1;
+    while (power < n) {
+      power *= 2;
+    }
+    return power;
+  }
+
+  // The hash is remixed so that stripes and the buckets inside a stripe do
+  // not depend on the same bits.
+  const Stripe &stripeFor(const T &element) const {
+    std::uint64_t h = std::hash<T>{}(element);
+    h *= 0x9E3779B97F4A7C15ull;
+    return stripes[(h >> 32) & mask];
+  }
+  Stripe &stripeFor(const T &element) {
+    return const_cast<Stripe &>(std::as_const(*this).stripeFor(element));
   }
 };
 
-template <typename T> std::size_t Set<T>::maxSize{2};
+// Throughput of ConcurrentSet<int> with readPercent% contains() calls and
+// the rest split between add() and remove(), for 1 to 64 threads.
+void benchmarkConcurrentSet(int readPercent) {
+  constexpr int keys = 1 << 20;
+  constexpr std::size_t totalOps = 1 << 21;
+  ConcurrentSet<int> set{};
+  for (int i = 0; i < keys; i += 2) {
+    set.add(i);
+  }
+
+  for (unsigned threads = 1; threads <= 64; threads *= 2) {
+    std::atomic<std::size_t> hits{0};
+    auto worker = [&](unsigned id) {
+      std::mt19937 rng(id);
+      std::size_t found = 0;
+      for (std::size_t op = 0; op < totalOps / threads; ++op) {
+        int key = static_cast<int>(rng() % keys);
+        auto kind = static_cast<int>(rng() % 100);
+        if (kind < readPercent) {
+          found += set.contains(key);
+        } else if (kind % 2) {
+          set.add(key);
+        } else {
+          set.remove(key);
+        }
+      }
+      hits += found;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned id = 0; id < threads; ++id) {
+      pool.emplace_back(worker, id);
+    }
+    for (auto &thread : pool) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << readPercent << "% reads, " << threads
+              << " threads: " << totalOps / elapsed.count() / 1e6
+              << " Mops/s\n";
+  }
+}
+
+#ifndef CPP4SEM_NO_MAIN
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    benchmarkConcurrentSet(95);
+    benchmarkConcurrentSet(50);
+    return 0;
+  }
 
-int main() {
-  Set<double> set1{};
+  Set<double> set1{SetPolicy{2, 1}};
 
   set1.add(3);
   set1.add(5);
@@ -159,5 +1343,88 @@ int main() {
   set2.add(2);
   std::cout << "Merge size:" << set1.merge(set2).size() << "\n";
   std::cout << "Intersect size:" << set1.intersect(set2).size() << "\n";
+  std::cout << "Difference size:" << set1.difference(set2).size() << "\n";
+  std::cout << "Symmetric difference size:"
+            << set1.symmetricDifference(set2).size() << "\n";
+
+  Set<int> oscillating{};
+  for (int i = 0; i < 32; ++i) {
+    oscillating.add(i);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    oscillating.add(32);
+    oscillating.remove(32);
+  }
+  std::cout << "Oscillating around 32: " << oscillating.getMigrations()
+            << " migrations, " << oscillating.getName() << "\n";
+
+  // About one write per 240 lookups: near the sorted tier's write budget for
+  // a million elements.
+  std::vector<long long> sparse(1 << 20);
+  for (std::size_t i = 0; i < sparse.size(); ++i) {
+    sparse[i] = static_cast<long long>(i) * 1000003;
+  }
+  Set<long long> nearBudget(sparse.begin(), sparse.end());
+  std::mt19937 ratioRng(1);
+  for (int i = 0; i < 200000; ++i) {
+    if (ratioRng() % 240 == 0) {
+      nearBudget.add(-static_cast<long long>(ratioRng()));
+    } else {
+      nearBudget.contains(sparse[ratioRng() % sparse.size()]);
+    }
+  }
+  std::cout << "Oscillating write ratio: " << nearBudget.getMigrations()
+            << " migrations, " << nearBudget.getName() << "\n";
+
+  Set<int> readMostly{};
+  for (int i = 0; i < 1000; ++i) {
+    readMostly.add(i * 1000003);
+  }
+  for (int i = 0; i < 100000; ++i) {
+    readMostly.contains(i % 2000 * 1000003);
+  }
+  readMostly.add(-1);
+  std::cout << "Read-mostly: " << readMostly.getName() << "\n";
+
+  std::vector<int> ids;
+  for (int i = 0; i < 1000000; ++i) {
+    ids.push_back(static_cast<int>(i * 7919LL % 1000000));
+  }
+  Set<int> loaded(ids.begin(), ids.end());
+  std::cout << "Bulk load of " << loaded.size() << ": " << loaded.getName()
+            << ", " << loaded.getMigrations() << " migrations\n";
+
+  Set<std::string> names{};
+  names.emplace(3, 'a');
+  names.add(std::string("bbb"));
+  std::cout << "Contains aaa? " << (names.contains("aaa") ? "Yes" : "No")
+            << "\n";
+
+  Set<int> evens{}, thirds{};
+  for (int i = 0; i < 1000000; i += 2) {
+    evens.add(i);
+  }
+  for (int i = 0; i < 1000000; i += 3) {
+    thirds.add(i);
+  }
+  std::cout << "Dense ids: " << evens.getName() << ", intersect size "
+            << evens.intersect(thirds).size() << ", unite size "
+            << evens.unite(thirds).size() << "\n";
+
+  ConcurrentSet<int> shared{};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&shared, t] {
+      for (int i = t; i < 40000; i += 4) {
+        shared.add(i);
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  std::cout << "Concurrent size: " << shared.size() << ", contains 39999? "
+            << (shared.contains(39999) ? "Yes" : "No") << "\n";
   return 0;
 }
+#endif